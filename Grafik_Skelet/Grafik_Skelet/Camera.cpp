@@ -22,24 +22,49 @@ Camera::Camera(glm::vec3 const& vrp,
 	this->window_width = window_width;
 	this->window_height = window_height;
 
-	// Init camera methods
-	this->ComputeViewOrientation(this->vrp, this->vpn, this->vup);
-	this->ComputeViewProjection(this->prp,	this->lower_left_window, this->upper_right_window, this->front_plane, this->back_plane);
-	this->ComputeWindowViewport(this->window_width, this->window_height);
+	// The matrices are computed the first time they are used
+	this->dirty = ALL_DIRTY;
+	this->revision = 0;
+}
 
-	// Set current transformation matrix
-	this->currenttransformationmatrix =  /* this->windowviewportmatrix * */ this->MperparMatrix * (this->viewprojectionmatrix * this->Rmatrix * this->Tmatrix);
-	this->invcurrenttransformationmatrix = glm::inverse(this->currenttransformationmatrix);
+Camera::Camera(Camera const& camera)
+{
+	*this = camera;
+}
+
+Camera const& Camera::operator=(Camera const& camera)
+{
+	this->vrp = camera.vrp;
+	this->vpn = camera.vpn;
+	this->vup = camera.vup;
+	this->prp = camera.prp;
+	this->lower_left_window = camera.lower_left_window;
+	this->upper_right_window = camera.upper_right_window;
+	this->front_plane = camera.front_plane;
+	this->back_plane = camera.back_plane;
+	this->window_width = camera.window_width;
+	this->window_height = camera.window_height;
+
+	// The cached matrices are not copied, they are computed again when they are used
+	this->dirty = ALL_DIRTY;
+	this->revision = camera.revision + 1;
+	return *this;
+}
+
+void Camera::Invalidate(unsigned int flags)
+{
+	this->dirty |= flags;
+	this->revision++;
 }
 
 // Compute the View Orientation Matrix
-void Camera::ComputeViewOrientation(glm::vec3& vrp, glm::vec3& vpn, glm::vec3& vup)
+void Camera::ComputeViewOrientation() const
 {
 	// Init the R-matrix
 	glm::mat4 R(1.0f);
 	// Compute rotations
-	glm::vec3 Rz = glm::normalize(vpn);
-	glm::vec3 Rx = glm::normalize(glm::cross(vup, Rz));
+	glm::vec3 Rz = glm::normalize(this->vpn);
+	glm::vec3 Rx = glm::normalize(glm::cross(this->vup, Rz));
 	glm::vec3 Ry = glm::normalize(glm::cross(Rz, Rx));
 	// Insert them in rows
 	glm::vec4 row1 = glm::vec4(Rx, 0.0f);
@@ -53,30 +78,34 @@ void Camera::ComputeViewOrientation(glm::vec3& vrp, glm::vec3& vpn, glm::vec3& v
 	R[0][3] = row4.x; R[1][3] = row4.y; R[2][3] = row4.z; R[3][3] = row4.w;
 
 	// Compute the Tvrp-matrix
-	glm::mat4 Tvrp = glm::translate(-vrp);	
+	glm::mat4 Tvrp = glm::translate(-this->vrp);	
 	
 	this->Rmatrix = R;
 	this->Tmatrix = Tvrp;
 	
 	// Combined
 	this->vieworientationmatrix = R * Tvrp;
-	this->invvieworientationmatrix = glm::inverse(this->vieworientationmatrix);
+
+	// The inverse is Tvrp^-1 * R^-1, and R is orthonormal so R^-1 is its transpose
+	this->invvieworientationmatrix = glm::translate(this->vrp) * glm::transpose(R);
+
+	// R is orthonormal, so the inverse transpose of the upper 3x3 part is R itself
+	this->normalmatrix = glm::mat3(R);
+	this->dirty &= ~VIEW_ORIENTATION_DIRTY;
 }
 
 // Compute the Projection Orientation Matrix
-void Camera::ComputeViewProjection(glm::vec3& prp,
-	glm::vec2& lower_left_window, glm::vec2& upper_right_window,
-	float front_clipping_plane, float back_clipping_plane)
+void Camera::ComputeViewProjection() const
 {
 	// Compute the Tprp-matrix
-	glm::mat4 Tprp = glm::translate(-prp);	
+	glm::mat4 Tprp = glm::translate(-this->prp);	
 
 	// Compute CW
-	glm::vec3 CW = glm::vec3((lower_left_window.x + upper_right_window.x) / 2.0f, 
-    (lower_left_window.y + upper_right_window.y) / 2.0f,
+	glm::vec3 CW = glm::vec3((this->lower_left_window.x + this->upper_right_window.x) / 2.0f, 
+    (this->lower_left_window.y + this->upper_right_window.y) / 2.0f,
     0.0f);
 	// Compute DOP
-	glm::vec4 DOP = glm::vec4(prp - CW, 0.0f);
+	glm::vec4 DOP = glm::vec4(this->prp - CW, 0.0f);
 
 	// Init the Sh matrix
 	glm::mat4 Sh(1.0f);
@@ -91,9 +120,9 @@ void Camera::ComputeViewProjection(glm::vec3& prp,
 	glm::vec4 VRP_mark = Sh * Tprp * vec; 
 
 	// Compute the scale factors for Sper
-	float sx = ( -2.0f * prp.z ) / ((upper_right_window.x - lower_left_window.x) * (back_clipping_plane - prp.z));
-	float sy = ( -2.0f * prp.z ) / ((upper_right_window.y - lower_left_window.y) * (back_clipping_plane - prp.z));
-	float sz = -1.0f / (back_clipping_plane - prp.z);
+	float sx = ( -2.0f * this->prp.z ) / ((this->upper_right_window.x - this->lower_left_window.x) * (this->back_plane - this->prp.z));
+	float sy = ( -2.0f * this->prp.z ) / ((this->upper_right_window.y - this->lower_left_window.y) * (this->back_plane - this->prp.z));
+	float sz = -1.0f / (this->back_plane - this->prp.z);
 
 	// Init the Sper-matrix
 	glm::mat4 Sper(1.0f);	
@@ -104,8 +133,8 @@ void Camera::ComputeViewProjection(glm::vec3& prp,
 
 	// Compute the scaling changes
 	float Zmin = -1.0f;
-	float Zmax = (front_clipping_plane - prp.z) / (back_clipping_plane - prp.z);
-	float Zp = prp.z / (back_clipping_plane - prp.z);
+	float Zmax = (this->front_plane - this->prp.z) / (this->back_plane - this->prp.z);
+	float Zp = this->prp.z / (this->back_plane - this->prp.z);
 
 	// Init the Mperpar-matrix
 	glm::mat4 Mperpar(1.0f);	
@@ -118,17 +147,38 @@ void Camera::ComputeViewProjection(glm::vec3& prp,
 
 	// Combined
 	this->viewprojectionmatrix = Sper * Sh * Tprp;
-	this->invviewprojectionmatrix = glm::inverse(this->viewprojectionmatrix );
+
+	// The inverse is Tprp^-1 * Sh^-1 * Sper^-1, the shear and scales are simply reversed
+	glm::mat4 invSh(1.0f);
+	invSh[2][0] = -shx;
+	invSh[2][1] = -shy;
+	glm::mat4 invSper(1.0f);
+	invSper[0][0] = 1.0f / sx;
+	invSper[1][1] = 1.0f / sy;
+	invSper[2][2] = 1.0f / sz;
+	this->invviewprojectionmatrix = glm::translate(this->prp) * invSh * invSper;
+
+	// Mperpar only mixes z and w, so only that 2x2 block has to be inverted
+	float a = Mperpar[2][2];
+	float b = Mperpar[3][2];
+	float det = a - Mperpar[2][3] * b;
+	glm::mat4 invMperpar(1.0f);
+	invMperpar[2][2] = 1.0f / det;
+	invMperpar[3][2] = -b / det;
+	invMperpar[2][3] = -Mperpar[2][3] / det;
+	invMperpar[3][3] = a / det;
+	this->invMperparMatrix = invMperpar;
+	this->dirty &= ~VIEW_PROJECTION_DIRTY;
 }
 
 // Compute the Window Viewport Matrix
-void Camera::ComputeWindowViewport(int window_width, int window_height)
+void Camera::ComputeWindowViewport() const
 {
 	// Init the S-matrix
 	glm::mat4 S(1.0f);	
 	// Insert values into the matrix
-	S[0][0] = window_width/2.0f;
-	S[1][1] = window_height/2.0f;;
+	S[0][0] = this->window_width/2.0f;
+	S[1][1] = this->window_height/2.0f;
 	S[2][2] = 1.0f;
 	S[3][3] = 1.0f;
 
@@ -143,46 +193,205 @@ void Camera::ComputeWindowViewport(int window_width, int window_height)
 
 	// Combined
 	this->windowviewportmatrix = Mwv;
-	this->invwindowviewportmatrix = glm::inverse(this->windowviewportmatrix);
+
+	// The inverse is T^-1 * S^-1
+	glm::mat4 invS(1.0f);
+	invS[0][0] = 2.0f / this->window_width;
+	invS[1][1] = 2.0f / this->window_height;
+	glm::mat4 invT(1.0f);
+	invT[3][0] = -1.0f;
+	invT[3][1] = -1.0f;
+	this->invwindowviewportmatrix = invT * invS;
+	this->dirty &= ~WINDOW_VIEWPORT_DIRTY;
+}
+
+// Compute the Current Transformation Matrix
+void Camera::ComputeCurrentTransformation() const
+{
+	if(this->dirty & VIEW_ORIENTATION_DIRTY) this->ComputeViewOrientation();
+	if(this->dirty & VIEW_PROJECTION_DIRTY) this->ComputeViewProjection();
+
+	this->currenttransformationmatrix =  /* this->windowviewportmatrix * */ this->MperparMatrix * (this->viewprojectionmatrix * this->Rmatrix * this->Tmatrix);
+	this->dirty &= ~TRANSFORMATION_DIRTY;
+}
+
+// Compute the planes of the view volume
+void Camera::ComputeClipPlanes() const
+{
+	// A point is inside when -w <= x, y, z <= w after the transformation, i.e. when
+	// dot(row3 +- rowi, p) >= 0 for the rows of the matrix (Gribb and Hartmann)
+	glm::mat4 m = this->ViewProjection() * this->ViewOrientation();
+	glm::vec4 row[4];
+	for (int r = 0; r < 4; r++) {
+		row[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+	}
+
+	// The front plane is at z = w, since the depth test keeps the greatest z
+	this->clipplanes[0] = row[3] + row[0];
+	this->clipplanes[1] = row[3] - row[0];
+	this->clipplanes[2] = row[3] + row[1];
+	this->clipplanes[3] = row[3] - row[1];
+	this->clipplanes[4] = row[3] - row[2];
+	this->clipplanes[5] = row[3] + row[2];
+
+	for (int i = 0; i < 6; i++) {
+		this->clipplanes[i] /= glm::length(glm::vec3(this->clipplanes[i]));
+	}
+	this->dirty &= ~CLIP_PLANES_DIRTY;
+}
+
+glm::mat4x4 const& Camera::ViewOrientation() const
+{
+	if(this->dirty & VIEW_ORIENTATION_DIRTY) this->ComputeViewOrientation();
+	return this->vieworientationmatrix;
+}
+
+glm::mat4x4 const& Camera::InvViewOrientation() const
+{
+	if(this->dirty & VIEW_ORIENTATION_DIRTY) this->ComputeViewOrientation();
+	return this->invvieworientationmatrix;
+}
+
+glm::mat3x3 const& Camera::NormalMatrix() const
+{
+	if(this->dirty & VIEW_ORIENTATION_DIRTY) this->ComputeViewOrientation();
+	return this->normalmatrix;
+}
+
+glm::mat4x4 const& Camera::ViewProjection() const
+{
+	if(this->dirty & VIEW_PROJECTION_DIRTY) this->ComputeViewProjection();
+	return this->viewprojectionmatrix;
+}
+
+glm::mat4x4 const& Camera::InvViewProjection() const
+{
+	if(this->dirty & VIEW_PROJECTION_DIRTY) this->ComputeViewProjection();
+	return this->invviewprojectionmatrix;
+}
+
+glm::mat4x4 const& Camera::WindowViewport() const
+{
+	if(this->dirty & WINDOW_VIEWPORT_DIRTY) this->ComputeWindowViewport();
+	return this->windowviewportmatrix;
+}
+
+glm::mat4x4 const& Camera::InvWindowViewport() const
+{
+	if(this->dirty & WINDOW_VIEWPORT_DIRTY) this->ComputeWindowViewport();
+	return this->invwindowviewportmatrix;
+}
+
+glm::mat4x4 const& Camera::CurrentTransformationMatrix() const
+{
+	if(this->dirty & TRANSFORMATION_DIRTY) this->ComputeCurrentTransformation();
+	return this->currenttransformationmatrix;
+}
+
+glm::mat4x4 const& Camera::InvCurrentTransformationMatrix() const
+{
+	if(this->dirty & INV_TRANSFORMATION_DIRTY) {
+		// Built from the inverses of the factors, in reverse order
+		this->CurrentTransformationMatrix();
+		this->invcurrenttransformationmatrix = this->invvieworientationmatrix * this->invviewprojectionmatrix * this->invMperparMatrix;
+		this->dirty &= ~INV_TRANSFORMATION_DIRTY;
+	}
+	return this->invcurrenttransformationmatrix;
+}
+
+glm::vec4 const* Camera::ClipPlanes() const
+{
+	if(this->dirty & CLIP_PLANES_DIRTY) this->ComputeClipPlanes();
+	return this->clipplanes;
 }
 
-glm::mat4x4 Camera::ViewOrientation() { return this->vieworientationmatrix; }
-glm::mat4x4 Camera::InvViewOrientation() { return this->invvieworientationmatrix;  }
-glm::mat4x4 Camera::ViewProjection() { return this->viewprojectionmatrix; }
-glm::mat4x4 Camera::InvViewProjection() { return this->invviewprojectionmatrix; }
-glm::mat4x4 Camera::WindowViewport() { return this->windowviewportmatrix; }
-glm::mat4x4 Camera::InvWindowViewport() { return this->invwindowviewportmatrix; }
-glm::mat4x4 Camera::CurrentTransformationMatrix() { return this->currenttransformationmatrix; }
-glm::mat4x4 Camera::InvCurrentTransformationMatrix() { return this->invcurrenttransformationmatrix; }
+unsigned int Camera::Revision() const { return this->revision; }
 
 glm::vec3 const& Camera::VRP() const { return this->vrp; }
-void Camera::VRP(glm::vec3 const& vrp) { this->vrp=vrp; }
+void Camera::VRP(glm::vec3 const& vrp)
+{
+	if(this->vrp == vrp) return;
+	this->vrp = vrp;
+	this->Invalidate(VIEW_ORIENTATION_DIRTY | TRANSFORMATION_DIRTY | INV_TRANSFORMATION_DIRTY | CLIP_PLANES_DIRTY);
+}
+
 glm::vec3 const& Camera::VPN() const { return this->vpn; }
-void Camera::VPN(glm::vec3 const& vpn) { this->vpn=vpn; }
+void Camera::VPN(glm::vec3 const& vpn)
+{
+	if(this->vpn == vpn) return;
+	this->vpn = vpn;
+	this->Invalidate(VIEW_ORIENTATION_DIRTY | TRANSFORMATION_DIRTY | INV_TRANSFORMATION_DIRTY | CLIP_PLANES_DIRTY);
+}
+
 glm::vec3 const& Camera::VUP() const { return this->vup; }
-void Camera::VUP(glm::vec3 const& vup) { this->vup=vup; }
+void Camera::VUP(glm::vec3 const& vup)
+{
+	if(this->vup == vup) return;
+	this->vup = vup;
+	this->Invalidate(VIEW_ORIENTATION_DIRTY | TRANSFORMATION_DIRTY | INV_TRANSFORMATION_DIRTY | CLIP_PLANES_DIRTY);
+}
+
 glm::vec3 const& Camera::PRP() const { return this->prp; }
-void Camera::PRP(glm::vec3 const& prp) { this->prp=prp; }
+void Camera::PRP(glm::vec3 const& prp)
+{
+	if(this->prp == prp) return;
+	this->prp = prp;
+	this->Invalidate(VIEW_PROJECTION_DIRTY | TRANSFORMATION_DIRTY | INV_TRANSFORMATION_DIRTY | CLIP_PLANES_DIRTY);
+}
 
 glm::vec2 const& Camera::WinLowerLeft() const { return this->lower_left_window; }
-void Camera::WinLowerLeft(glm::vec2 const& lower_left_window) { this->lower_left_window = lower_left_window; }
-glm::vec2 const& Camera::WinUpperRight() const { return this->upper_right_window; };
-void Camera::WinUpperRight(glm::vec2 const& upper_right_window) { this->upper_right_window = upper_right_window; };
+void Camera::WinLowerLeft(glm::vec2 const& lower_left_window)
+{
+	if(this->lower_left_window == lower_left_window) return;
+	this->lower_left_window = lower_left_window;
+	this->Invalidate(VIEW_PROJECTION_DIRTY | TRANSFORMATION_DIRTY | INV_TRANSFORMATION_DIRTY | CLIP_PLANES_DIRTY);
+}
+
+glm::vec2 const& Camera::WinUpperRight() const { return this->upper_right_window; }
+void Camera::WinUpperRight(glm::vec2 const& upper_right_window)
+{
+	if(this->upper_right_window == upper_right_window) return;
+	this->upper_right_window = upper_right_window;
+	this->Invalidate(VIEW_PROJECTION_DIRTY | TRANSFORMATION_DIRTY | INV_TRANSFORMATION_DIRTY | CLIP_PLANES_DIRTY);
+}
 
 float Camera::FrontClippingPlane() const { return this->front_plane; }
-void Camera::FrontClippingPlane(float const front_plane) { this->front_plane=front_plane; }
+void Camera::FrontClippingPlane(float const front_plane)
+{
+	if(this->front_plane == front_plane) return;
+	this->front_plane = front_plane;
+	this->Invalidate(VIEW_PROJECTION_DIRTY | TRANSFORMATION_DIRTY | INV_TRANSFORMATION_DIRTY | CLIP_PLANES_DIRTY);
+}
+
 float Camera::BackClippingPlane() const { return this->back_plane; }
-void Camera::BackClippingPlane(float const back_plane) { this->back_plane=back_plane; }
+void Camera::BackClippingPlane(float const back_plane)
+{
+	if(this->back_plane == back_plane) return;
+	this->back_plane = back_plane;
+	this->Invalidate(VIEW_PROJECTION_DIRTY | TRANSFORMATION_DIRTY | INV_TRANSFORMATION_DIRTY | CLIP_PLANES_DIRTY);
+}
 
-int Camera::WindowWidth() { return window_width; }
-void Camera::WindowWidth(int new_window_width){ this->window_width = new_window_width; }
-int Camera::WindowHeight(){  return this->window_height;}
-void Camera::WindowHeight(int new_window_height){  this->window_height = new_window_height;}
+int Camera::WindowWidth() const { return this->window_width; }
+void Camera::WindowWidth(int new_window_width)
+{
+	if(this->window_width == new_window_width) return;
+	this->window_width = new_window_width;
+	this->Invalidate(WINDOW_VIEWPORT_DIRTY);
+}
 
-Camera::Camera(void)
+int Camera::WindowHeight() const { return this->window_height; }
+void Camera::WindowHeight(int new_window_height)
 {
+	if(this->window_height == new_window_height) return;
+	this->window_height = new_window_height;
+	this->Invalidate(WINDOW_VIEWPORT_DIRTY);
 }
 
+Camera::Camera(void)
+{
+	this->dirty = ALL_DIRTY;
+	this->revision = 0;
+}
 
 Camera::~Camera(void)
 {
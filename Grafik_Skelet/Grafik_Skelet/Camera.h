@@ -67,43 +67,68 @@ public:
 	/**
 	* \return the current ViewOrientation matrix.
 	*/
-	glm::mat4x4 ViewOrientation();
+	glm::mat4x4 const& ViewOrientation() const;
 
 	/**
 	* \return the inverse of the current ViewOrientation matrix.
 	*/
-	glm::mat4x4 InvViewOrientation();
+	glm::mat4x4 const& InvViewOrientation() const;
 
 	/**
 	* \return the current ViewProjection matrix.
 	*/
-	glm::mat4x4 ViewProjection();
+	glm::mat4x4 const& ViewProjection() const;
 
 	/**
 	* \return the inverse of the current ViewProjection matrix.
 	*/
-	glm::mat4x4 InvViewProjection();
+	glm::mat4x4 const& InvViewProjection() const;
 
 	/**
 	* \return the current WindowViewport matrix.
 	*/
-	glm::mat4x4 WindowViewport();
+	glm::mat4x4 const& WindowViewport() const;
 
 	/**
 	* \return the inverse of the current WindowViewport matrix.
 	*/
-	glm::mat4x4 InvWindowViewport();
+	glm::mat4x4 const& InvWindowViewport() const;
 
 	/**
 	* \return the current transformation matrix = WindowViewport() * ViewProjection() * ViewOrientation().
+	* The matrices are cached, and only computed again after a parameter they depend on
+	* has been changed, so the references stay valid and unchanged until then.
 	*/
-	glm::mat4x4 CurrentTransformationMatrix();
+	glm::mat4x4 const& CurrentTransformationMatrix() const;
 
 	/**
 	* \return the inverse of the current transformation 
 	* matrix = InvViewOrientation() * InvViewProjection() * InvWindowViewport().
+	* The inverses are built directly from the camera parameters, not by general matrix inversion.
 	*/
-	glm::mat4x4 InvCurrentTransformationMatrix();
+	glm::mat4x4 const& InvCurrentTransformationMatrix() const;
+
+	/**
+	* \return the matrix which transforms normal vectors to eye coordinates, i.e. the inverse
+	* transpose of the upper 3x3 part of ViewOrientation().
+	*/
+	glm::mat3x3 const& NormalMatrix() const;
+
+	/**
+	* \return the six planes of the view volume in world coordinates, in the order left, right,
+	* bottom, top, front and back. They are extracted from ViewProjection() * ViewOrientation(),
+	* which are the matrices the renderers use, so -w <= x, y, z <= w after that transformation.
+	* A point p is inside plane i when dot(planes[i], vec4(p, 1)) >= 0, and the normals (xyz)
+	* have unit length, so the dot product is the signed distance to the plane.
+	*/
+	glm::vec4 const* ClipPlanes() const;
+
+	/**
+	* \return a counter which is incremented every time a parameter of the camera is changed.
+	* The matrices are the same as long as the counter is the same, so it can be used
+	* to skip uploading them again.
+	*/
+	unsigned int Revision() const;
 
 	/**
 	* \return the current value of the View Reference Point.
@@ -196,7 +221,7 @@ public:
 	/**
 	* \return the value of the Window width
 	*/
-	int WindowWidth();
+	int WindowWidth() const;
 
 	/**
 	* Changes the Window width
@@ -207,7 +232,7 @@ public:
 	/**
 	* \return the value of the Window height
 	*/
-	int WindowHeight();
+	int WindowHeight() const;
 
 	/**
 	* Changes the Window height
@@ -218,32 +243,58 @@ public:
 protected:
 
 private:
+	// The matrices which have to be computed again before they are returned
+	enum {
+		VIEW_ORIENTATION_DIRTY = 1,
+		VIEW_PROJECTION_DIRTY = 2,
+		WINDOW_VIEWPORT_DIRTY = 4,
+		TRANSFORMATION_DIRTY = 8,
+		INV_TRANSFORMATION_DIRTY = 16,
+		CLIP_PLANES_DIRTY = 32,
+		ALL_DIRTY = 63
+	};
+
+	// Marks the matrices as dirty and increments the revision
+	void Invalidate(unsigned int flags);
+
 	// Compute the View Orientation Matrix
-	void ComputeViewOrientation(glm::vec3& vrp, glm::vec3& vpn, glm::vec3& vup);
+	void ComputeViewOrientation() const;
 
 	// Compute the Projection Orientation Matrix
-	void ComputeViewProjection(glm::vec3& prp, 
-		glm::vec2& lower_left_window, glm::vec2& upper_right_window,
-		float front_clipping_plane, float back_clipping_plane);
+	void ComputeViewProjection() const;
 
 	// Compute the Window Viewport Matrix
-	void ComputeWindowViewport(int window_width, int window_height);
+	void ComputeWindowViewport() const;
+
+	// Compute the Current Transformation Matrix
+	void ComputeCurrentTransformation() const;
+
+	// Compute the planes of the view volume
+	void ComputeClipPlanes() const;
+
+	// The matrices which are out of date
+	mutable unsigned int dirty;
+	unsigned int revision;
 
 	// The View Orientation Matrix
-	glm::mat4x4 vieworientationmatrix;
-	glm::mat4x4 invvieworientationmatrix;
+	mutable glm::mat4x4 vieworientationmatrix;
+	mutable glm::mat4x4 invvieworientationmatrix;
+	mutable glm::mat3x3 normalmatrix;
 	
 	// The View Projection Matrix
-	glm::mat4x4 viewprojectionmatrix;
-	glm::mat4x4 invviewprojectionmatrix;
+	mutable glm::mat4x4 viewprojectionmatrix;
+	mutable glm::mat4x4 invviewprojectionmatrix;
 
 	// The Window Viewport Matrix
-	glm::mat4x4 windowviewportmatrix;
-	glm::mat4x4 invwindowviewportmatrix;
+	mutable glm::mat4x4 windowviewportmatrix;
+	mutable glm::mat4x4 invwindowviewportmatrix;
 
 	// The Current Transformation Matrix;
-	glm::mat4x4 currenttransformationmatrix;
-	glm::mat4x4 invcurrenttransformationmatrix;
+	mutable glm::mat4x4 currenttransformationmatrix;
+	mutable glm::mat4x4 invcurrenttransformationmatrix;
+
+	// The planes of the view volume in world coordinates
+	mutable glm::vec4 clipplanes[6];
 
 	// The View Reference Point
 	glm::vec3 vrp;
@@ -275,9 +326,10 @@ private:
 	// Window height
 	int window_height;
 
-    glm::mat4x4 Rmatrix;
-	glm::mat4x4 Tmatrix;
-	glm::mat4x4 MperparMatrix;
+	mutable glm::mat4x4 Rmatrix;
+	mutable glm::mat4x4 Tmatrix;
+	mutable glm::mat4x4 MperparMatrix;
+	mutable glm::mat4x4 invMperparMatrix;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include "Clipper.h"
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+// Keeps w away from zero, so the perspective division is always defined
+static const float W_EPSILON = 1.0e-5f;
+
+// Signed distance to a plane, the last plane is w >= W_EPSILON
+static float distance(glm::vec4 const planes[], int i, int num_planes, glm::vec4 const& position)
+{
+	float d = glm::dot(planes[i], position);
+	return (i == num_planes - 1) ? d - W_EPSILON : d;
+}
+
+// Bit i of the outcode is set when the position is outside plane i
+static int outcode(glm::vec4 const& position, glm::vec4 const planes[], int num_planes)
+{
+	int code = 0;
+	for (int i = 0; i < num_planes; i++) {
+		if (distance(planes, i, num_planes, position) < 0.0f) {
+			code |= (1 << i);
+		}
+	}
+	return code;
+}
+
+Clipper::Clipper(void)
+{
+	this->guard_band(2.0f);
+}
+
+Clipper::~Clipper(void)
+{
+}
+
+void Clipper::guard_band(float factor)
+{
+	if (factor < 1.0f) {
+		throw std::invalid_argument("clipper::guard_band(): factor must be >= 1");
+	}
+	this->guard_factor = factor;
+
+	// Left, right, bottom, top, front, back, and w > 0 which must be the last plane
+	this->view_planes[0] = glm::vec4( 1.0f,  0.0f,  0.0f, 1.0f);
+	this->view_planes[1] = glm::vec4(-1.0f,  0.0f,  0.0f, 1.0f);
+	this->view_planes[2] = glm::vec4( 0.0f,  1.0f,  0.0f, 1.0f);
+	this->view_planes[3] = glm::vec4( 0.0f, -1.0f,  0.0f, 1.0f);
+	this->view_planes[4] = glm::vec4( 0.0f,  0.0f,  1.0f, 1.0f);
+	this->view_planes[5] = glm::vec4( 0.0f,  0.0f, -1.0f, 1.0f);
+	this->view_planes[6] = glm::vec4( 0.0f,  0.0f,  0.0f, 1.0f);
+
+	for (int i = 0; i < NUM_PLANES; i++) {
+		this->guard_planes[i] = this->view_planes[i];
+	}
+	for (int i = 0; i < 4; i++) {
+		this->guard_planes[i].w = factor;
+	}
+}
+
+float Clipper::guard_band() const
+{
+	return this->guard_factor;
+}
+
+Clip_vertex Clipper::lerp(Clip_vertex const& v1, Clip_vertex const& v2, float t)
+{
+	Clip_vertex v;
+	v.position = v1.position + (v2.position - v1.position) * t;
+	v.num_attributes = std::min(v1.num_attributes, v2.num_attributes);
+	for (int i = 0; i < v.num_attributes; i++) {
+		v.attributes[i] = v1.attributes[i] + (v2.attributes[i] - v1.attributes[i]) * t;
+	}
+	return v;
+}
+
+void Clipper::clip_lines(std::vector<Clip_vertex> const& in, std::vector<Clip_vertex>& out) const
+{
+	for (size_t n = 0; n + 1 < in.size(); n += 2) {
+		glm::vec4 const& p1 = in[n].position;
+		glm::vec4 const& p2 = in[n + 1].position;
+
+		// Liang-Barsky in homogeneous coordinates
+		float t_enter = 0.0f;
+		float t_leave = 1.0f;
+		bool visible = true;
+		for (int i = 0; i < NUM_PLANES && visible; i++) {
+			float d1 = distance(this->view_planes, i, NUM_PLANES, p1);
+			float d2 = distance(this->view_planes, i, NUM_PLANES, p2);
+
+			if (d1 < 0.0f && d2 < 0.0f) {
+				visible = false;
+			}
+			else if (d1 < 0.0f) {
+				t_enter = std::max(t_enter, d1 / (d1 - d2));
+			}
+			else if (d2 < 0.0f) {
+				t_leave = std::min(t_leave, d1 / (d1 - d2));
+			}
+			visible = visible && (t_enter <= t_leave);
+		}
+
+		if (visible) {
+			out.push_back((t_enter > 0.0f) ? lerp(in[n], in[n + 1], t_enter) : in[n]);
+			out.push_back((t_leave < 1.0f) ? lerp(in[n], in[n + 1], t_leave) : in[n + 1]);
+		}
+	}
+}
+
+void Clipper::clip_triangles(std::vector<Clip_vertex> const& in, std::vector<Clip_vertex>& out) const
+{
+	for (size_t n = 0; n + 2 < in.size(); n += 3) {
+		Clip_vertex const& v1 = in[n];
+		Clip_vertex const& v2 = in[n + 1];
+		Clip_vertex const& v3 = in[n + 2];
+
+		// Trivial reject if all vertices are outside the same plane of the view volume
+		int code1 = outcode(v1.position, this->view_planes, NUM_PLANES);
+		int code2 = outcode(v2.position, this->view_planes, NUM_PLANES);
+		int code3 = outcode(v3.position, this->view_planes, NUM_PLANES);
+		if ((code1 & code2 & code3) != 0) {
+			continue;
+		}
+
+		// Trivial accept if all vertices are inside the guard band and the front and back planes
+		int guard1 = outcode(v1.position, this->guard_planes, NUM_PLANES);
+		int guard2 = outcode(v2.position, this->guard_planes, NUM_PLANES);
+		int guard3 = outcode(v3.position, this->guard_planes, NUM_PLANES);
+		if ((guard1 | guard2 | guard3) == 0) {
+			out.push_back(v1);
+			out.push_back(v2);
+			out.push_back(v3);
+			continue;
+		}
+
+		this->clip_triangle(v1, v2, v3, out);
+	}
+}
+
+void Clipper::clip_triangle(Clip_vertex const& v1, Clip_vertex const& v2, Clip_vertex const& v3,
+							std::vector<Clip_vertex>& out) const
+{
+	Clip_vertex buffers[2][MAX_POLYGON];
+	Clip_vertex* polygon = buffers[0];
+	Clip_vertex* clipped = buffers[1];
+
+	polygon[0] = v1;
+	polygon[1] = v2;
+	polygon[2] = v3;
+	int count = 3;
+
+	// Sutherland-Hodgman against each plane of the guard band
+	for (int i = 0; i < NUM_PLANES && count > 0; i++) {
+		int clipped_count = 0;
+		for (int k = 0; k < count; k++) {
+			Clip_vertex const& current = polygon[k];
+			Clip_vertex const& next = polygon[(k + 1) % count];
+			float d_current = distance(this->guard_planes, i, NUM_PLANES, current.position);
+			float d_next = distance(this->guard_planes, i, NUM_PLANES, next.position);
+
+			if (d_current >= 0.0f) {
+				clipped[clipped_count++] = current;
+			}
+			if ((d_current >= 0.0f) != (d_next >= 0.0f)) {
+				clipped[clipped_count++] = lerp(current, next, d_current / (d_current - d_next));
+			}
+		}
+
+		std::swap(polygon, clipped);
+		count = clipped_count;
+	}
+
+	// Triangulate the convex polygon as a fan
+	for (int k = 1; k + 1 < count; k++) {
+		out.push_back(polygon[0]);
+		out.push_back(polygon[k]);
+		out.push_back(polygon[k + 1]);
+	}
+}
+
+Raster_vertex Clipper::to_window(Clip_vertex const& v, glm::mat4x4 const& window_viewport)
+{
+	glm::vec4 ndc = v.position / v.position.w;
+	glm::vec4 window = window_viewport * glm::vec4(ndc.x, ndc.y, ndc.z, 1.0f);
+
+	Raster_vertex r;
+	r.x = int(std::floor(window.x + 0.5f));
+	r.y = int(std::floor(window.y + 0.5f));
+	r.z = window.z;
+	r.w = v.position.w;
+	r.num_attributes = v.num_attributes;
+	for (int i = 0; i < v.num_attributes; i++) {
+		r.attributes[i] = v.attributes[i];
+	}
+	return r;
+}
+
+void Clipper::to_window(std::vector<Clip_vertex> const& in, glm::mat4x4 const& window_viewport,
+						std::vector<Raster_vertex>& out)
+{
+	out.reserve(out.size() + in.size());
+	for (size_t n = 0; n < in.size(); n++) {
+		out.push_back(to_window(in[n], window_viewport));
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+
+#include "glmutils.h"
+#include "Raster_vertex.h"
+
+/**
+* A vertex in homogeneous clip coordinates, i.e. after the transformations
+* of the Camera but before the perspective division.
+*/
+struct Clip_vertex
+{
+	Clip_vertex() : position(0.0f, 0.0f, 0.0f, 1.0f), num_attributes(0) {}
+
+	glm::vec4 position;
+
+	int num_attributes;
+	float attributes[MAX_RASTER_ATTRIBUTES];
+};
+
+/**
+* Clips lines and triangles against the view volume -w <= x, y, z <= w.
+* Lines are clipped with Liang-Barsky, triangles with Sutherland-Hodgman.
+* Triangles are always clipped against the front and back planes, but only
+* against the sides when they cross the guard band, since the rasterizer
+* can discard the fragments outside the window cheaper than it can be clipped.
+*/
+class Clipper
+{
+public:
+	Clipper(void);
+	virtual ~Clipper(void);
+
+	// The size of the guard band in multiples of the window, must be >= 1
+	void guard_band(float factor);
+	float guard_band() const;
+
+	// Clips the line segments given as pairs of vertices, the visible parts are appended to out
+	void clip_lines(std::vector<Clip_vertex> const& in, std::vector<Clip_vertex>& out) const;
+	// Clips the triangles given as triples of vertices, the resulting triangles are appended to out
+	void clip_triangles(std::vector<Clip_vertex> const& in, std::vector<Clip_vertex>& out) const;
+
+	// Divides by w and maps the vertex to window coordinates with the WindowViewport matrix of a Camera
+	static Raster_vertex to_window(Clip_vertex const& v, glm::mat4x4 const& window_viewport);
+	static void to_window(std::vector<Clip_vertex> const& in, glm::mat4x4 const& window_viewport,
+						  std::vector<Raster_vertex>& out);
+private:
+	static const int NUM_PLANES = 7;
+	static const int MAX_POLYGON = 3 + NUM_PLANES;
+
+	void clip_triangle(Clip_vertex const& v1, Clip_vertex const& v2, Clip_vertex const& v3,
+					   std::vector<Clip_vertex>& out) const;
+
+	static Clip_vertex lerp(Clip_vertex const& v1, Clip_vertex const& v2, float t);
+
+	// The planes are given as vectors p where dot(p, position) >= 0 inside the plane
+	glm::vec4 view_planes[NUM_PLANES];
+	glm::vec4 guard_planes[NUM_PLANES];
+
+	float guard_factor;
+};
+
@@ -0,0 +1,213 @@
+#include "Depth_buffer.h"
+#include <algorithm>
+
+Depth_buffer::Depth_buffer(int width, int height)
+	: tiles_x(0), tiles_y(0), blocks_x(0), blocks_y(0),
+	  buffer_width(0), buffer_height(0), clear_value(1.0f), func(LESS)
+{
+	this->resize(width, height);
+}
+
+Depth_buffer::~Depth_buffer()
+{
+}
+
+void Depth_buffer::resize(int width, int height)
+{
+	this->buffer_width = std::max(width, 0);
+	this->buffer_height = std::max(height, 0);
+	this->depths.assign(this->buffer_width * this->buffer_height, this->clear_value);
+
+	this->tiles_x = (this->buffer_width + TILE_SIZE - 1) / TILE_SIZE;
+	this->tiles_y = (this->buffer_height + TILE_SIZE - 1) / TILE_SIZE;
+	this->blocks_x = (this->tiles_x + TILE_SIZE - 1) / TILE_SIZE;
+	this->blocks_y = (this->tiles_y + TILE_SIZE - 1) / TILE_SIZE;
+	this->tiles.resize(this->tiles_x * this->tiles_y);
+	this->blocks.resize(this->blocks_x * this->blocks_y);
+	this->reset_bounds();
+}
+
+void Depth_buffer::clear()
+{
+	std::fill(this->depths.begin(), this->depths.end(), this->clear_value);
+	this->reset_bounds();
+}
+
+void Depth_buffer::reset_bounds()
+{
+	Depth_bounds cleared;
+	cleared.min = this->clear_value;
+	cleared.max = this->clear_value;
+	cleared.dirty = false;
+
+	std::fill(this->tiles.begin(), this->tiles.end(), cleared);
+	std::fill(this->blocks.begin(), this->blocks.end(), cleared);
+}
+
+void Depth_buffer::clear_depth(float depth) { this->clear_value = depth; }
+float Depth_buffer::clear_depth() const { return this->clear_value; }
+
+void Depth_buffer::depth_func(Compare func) { this->func = func; }
+Depth_buffer::Compare Depth_buffer::depth_func() const { return this->func; }
+
+bool Depth_buffer::compare(float z, float stored) const
+{
+	switch (this->func) {
+	case NEVER:		return false;
+	case LESS:		return z < stored;
+	case EQUAL:		return z == stored;
+	case LEQUAL:	return z <= stored;
+	case GREATER:	return z > stored;
+	case NOTEQUAL:	return z != stored;
+	case GEQUAL:	return z >= stored;
+	default:		return true;
+	}
+}
+
+bool Depth_buffer::test(int x, int y, float z) const
+{
+	// Fragments outside the buffer are discarded
+	if (x < 0 || y < 0 || x >= this->buffer_width || y >= this->buffer_height) {
+		return false;
+	}
+	return this->compare(z, this->depths[y * this->buffer_width + x]);
+}
+
+bool Depth_buffer::test_and_write(int x, int y, float z)
+{
+	if (!this->test(x, y, z)) {
+		return false;
+	}
+	float& stored = this->depths[y * this->buffer_width + x];
+	this->update_bounds(x, y, stored, z);
+	stored = z;
+	return true;
+}
+
+void Depth_buffer::update_bounds(int x, int y, float old_z, float z)
+{
+	Depth_bounds& tile = this->tiles[(y / TILE_SIZE) * this->tiles_x + (x / TILE_SIZE)];
+	Depth_bounds& block = this->blocks[(y / (TILE_SIZE * TILE_SIZE)) * this->blocks_x + (x / (TILE_SIZE * TILE_SIZE))];
+
+	// If the old depth was one of the bounds, the bound may now be too wide
+	if (old_z <= tile.min || old_z >= tile.max) {
+		tile.dirty = true;
+		block.dirty = true;
+	}
+
+	tile.min = std::min(tile.min, z);
+	tile.max = std::max(tile.max, z);
+	block.min = std::min(block.min, z);
+	block.max = std::max(block.max, z);
+}
+
+Depth_buffer::Depth_bounds const& Depth_buffer::tile_bounds(int tile_x, int tile_y)
+{
+	Depth_bounds& tile = this->tiles[tile_y * this->tiles_x + tile_x];
+	if (tile.dirty) {
+		int x_start = tile_x * TILE_SIZE;
+		int y_start = tile_y * TILE_SIZE;
+		int x_stop = std::min(x_start + TILE_SIZE, this->buffer_width);
+		int y_stop = std::min(y_start + TILE_SIZE, this->buffer_height);
+
+		float* row = &this->depths[y_start * this->buffer_width];
+		tile.min = tile.max = row[x_start];
+		for (int y = y_start; y < y_stop; y++, row += this->buffer_width) {
+			for (int x = x_start; x < x_stop; x++) {
+				tile.min = std::min(tile.min, row[x]);
+				tile.max = std::max(tile.max, row[x]);
+			}
+		}
+		tile.dirty = false;
+	}
+	return tile;
+}
+
+Depth_buffer::Depth_bounds const& Depth_buffer::block_bounds(int block_x, int block_y)
+{
+	Depth_bounds& block = this->blocks[block_y * this->blocks_x + block_x];
+	if (block.dirty) {
+		int tile_x_start = block_x * TILE_SIZE;
+		int tile_y_start = block_y * TILE_SIZE;
+		int tile_x_stop = std::min(tile_x_start + TILE_SIZE, this->tiles_x);
+		int tile_y_stop = std::min(tile_y_start + TILE_SIZE, this->tiles_y);
+
+		block.min = block.max = this->tile_bounds(tile_x_start, tile_y_start).min;
+		for (int ty = tile_y_start; ty < tile_y_stop; ty++) {
+			for (int tx = tile_x_start; tx < tile_x_stop; tx++) {
+				Depth_bounds const& tile = this->tile_bounds(tx, ty);
+				block.min = std::min(block.min, tile.min);
+				block.max = std::max(block.max, tile.max);
+			}
+		}
+		block.dirty = false;
+	}
+	return block;
+}
+
+bool Depth_buffer::bounds_occluded(float z_min, float z_max, float stored_min, float stored_max) const
+{
+	switch (this->func) {
+	case NEVER:		return true;
+	case LESS:		return z_min >= stored_max;
+	case LEQUAL:	return z_min > stored_max;
+	case GREATER:	return z_max <= stored_min;
+	case GEQUAL:	return z_max < stored_min;
+	default:		return false;
+	}
+}
+
+bool Depth_buffer::tile_occluded(int tile_x, int tile_y, float z_min, float z_max)
+{
+	// Fragments outside the buffer never pass the depth test
+	if (tile_x < 0 || tile_y < 0 || tile_x >= this->tiles_x || tile_y >= this->tiles_y) {
+		return true;
+	}
+	Depth_bounds const& tile = this->tile_bounds(tile_x, tile_y);
+	return this->bounds_occluded(z_min, z_max, tile.min, tile.max);
+}
+
+bool Depth_buffer::occluded(int x_min, int y_min, int x_max, int y_max, float z_min, float z_max)
+{
+	x_min = std::max(x_min, 0);
+	y_min = std::max(y_min, 0);
+	x_max = std::min(x_max, this->buffer_width - 1);
+	y_max = std::min(y_max, this->buffer_height - 1);
+	if (x_min > x_max || y_min > y_max) {
+		return true;
+	}
+
+	int tile_x_min = x_min / TILE_SIZE; int tile_x_max = x_max / TILE_SIZE;
+	int tile_y_min = y_min / TILE_SIZE; int tile_y_max = y_max / TILE_SIZE;
+
+	// Test the blocks first, and only look at the tiles of the blocks which are not occluded
+	for (int by = tile_y_min / TILE_SIZE; by <= tile_y_max / TILE_SIZE; by++) {
+		for (int bx = tile_x_min / TILE_SIZE; bx <= tile_x_max / TILE_SIZE; bx++) {
+			Depth_bounds const& block = this->block_bounds(bx, by);
+			if (this->bounds_occluded(z_min, z_max, block.min, block.max)) {
+				continue;
+			}
+
+			int ty_start = std::max(tile_y_min, by * TILE_SIZE);
+			int ty_stop = std::min(tile_y_max, by * TILE_SIZE + TILE_SIZE - 1);
+			int tx_start = std::max(tile_x_min, bx * TILE_SIZE);
+			int tx_stop = std::min(tile_x_max, bx * TILE_SIZE + TILE_SIZE - 1);
+			for (int ty = ty_start; ty <= ty_stop; ty++) {
+				for (int tx = tx_start; tx <= tx_stop; tx++) {
+					if (!this->tile_occluded(tx, ty, z_min, z_max)) {
+						return false;
+					}
+				}
+			}
+		}
+	}
+	return true;
+}
+
+float Depth_buffer::depth(int x, int y) const
+{
+	return this->depths[y * this->buffer_width + x];
+}
+
+int Depth_buffer::width() const { return this->buffer_width; }
+int Depth_buffer::height() const { return this->buffer_height; }
@@ -0,0 +1,78 @@
+#pragma once
+#include <vector>
+
+/**
+* A 32-bit floating point depth buffer for the software rasterizer.
+* The compare functions and the clear value work like glDepthFunc and glClearDepth.
+*
+* Besides the per-pixel depths the buffer keeps the min/max depth of every
+* TILE_SIZE x TILE_SIZE tile, and of every block of TILE_SIZE x TILE_SIZE tiles,
+* so whole triangles or tiles can be rejected before any per-pixel test.
+* The bounds are widened when a depth is written, and only recomputed from
+* the pixels when a written pixel held one of the bounds of its tile.
+*/
+class Depth_buffer
+{
+public:
+	enum Compare { NEVER, LESS, EQUAL, LEQUAL, GREATER, NOTEQUAL, GEQUAL, ALWAYS };
+
+	Depth_buffer(int width, int height);
+	virtual ~Depth_buffer();
+
+	void resize(int width, int height);
+	void clear();
+
+	void clear_depth(float depth);
+	float clear_depth() const;
+
+	void depth_func(Compare func);
+	Compare depth_func() const;
+
+	// Returns true if a fragment with depth z at (x, y) passes the depth test
+	bool test(int x, int y, float z) const;
+	// As test(), but the depth is written if the test passes
+	bool test_and_write(int x, int y, float z);
+
+	float depth(int x, int y) const;
+
+	static const int TILE_SIZE = 8;
+
+	// Returns true if every fragment with a depth in [z_min, z_max] inside the
+	// rectangle [x_min, x_max] x [y_min, y_max] is certain to fail the depth test
+	bool occluded(int x_min, int y_min, int x_max, int y_max, float z_min, float z_max);
+	// As occluded(), for the single tile with tile coordinates (tile_x, tile_y)
+	bool tile_occluded(int tile_x, int tile_y, float z_min, float z_max);
+
+	int width() const;
+	int height() const;
+private:
+	bool compare(float z, float stored) const;
+	bool bounds_occluded(float z_min, float z_max, float stored_min, float stored_max) const;
+
+	// Min/max depth pyramid, level 0 are tiles and level 1 are blocks of tiles
+	struct Depth_bounds
+	{
+		float min;
+		float max;
+		bool dirty;
+	};
+
+	void reset_bounds();
+	void update_bounds(int x, int y, float old_z, float z);
+	Depth_bounds const& tile_bounds(int tile_x, int tile_y);
+	Depth_bounds const& block_bounds(int block_x, int block_y);
+
+	int tiles_x; int tiles_y;
+	int blocks_x; int blocks_y;
+	std::vector<Depth_bounds> tiles;
+	std::vector<Depth_bounds> blocks;
+
+	int buffer_width;
+	int buffer_height;
+
+	float clear_value;
+	Compare func;
+
+	std::vector<float> depths;
+};
+
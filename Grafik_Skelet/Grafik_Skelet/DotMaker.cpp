@@ -7,6 +7,8 @@
 
 #include "DotMaker.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <string>
 using std::string;
 
@@ -18,22 +20,33 @@ static GLfloat matrix[16] = {
 	0.0f, 0.0f, 1.0f, 0.0f,
 	0.0f, 0.0f, 0.0f, 1.0f};
 
+// Every dot is an instance of the points of one dot, with its own offset and color
 static string vs =
 "#version 330\n\
 layout(location = 0) in vec3 vertPosition; \n\
+layout(location = 1) in vec2 dotOffset; \n\
+layout(location = 2) in vec3 dotColor; \n\
 uniform mat4 uModelMatrix; \n\
+flat out vec3 color; \n\
 void main() { \n\
-    gl_Position = uModelMatrix * vec4(vertPosition, 1.0); \n\
+    color = dotColor; \n\
+    gl_Position = uModelMatrix * vec4(vertPosition + vec3(dotOffset, 0.0), 1.0); \n\
 }";
 
 static string fs =
 "#version 330 \n\
 layout(location = 0) out vec4 colourOut; \n\
-uniform vec3 uColorVec;\n\
+flat in vec3 color; \n\
 void main() { \n\
-    colourOut = vec4(uColorVec, 1.0); \n\
+    colourOut = vec4(color, 1.0); \n\
 }";
 
+// Dots are drawn when this many have been collected, or by flush()
+static const size_t MAX_BATCH_DOTS = 16384;
+
+// Created by the first call to instance(), and deleted by release() while the context exists
+static DotMaker* dotMaker = NULL;
+
 DotMaker::DotMaker()
 {
 	m_dotParts = NULL;
@@ -44,12 +57,22 @@ DotMaker::DotMaker()
 	m_r = m_g = m_b = 1.0f;
 
 	m_shaderID = ShaderProgram::compileShaderProgram(vs, fs);
+	m_matrixLocation = ShaderProgram::uniformLocation(m_shaderID, "uModelMatrix");
 
 	// Generate and bind 2*1 buffer
 	glGenBuffers(1, &m_vertexBufferDot);
 	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferDot);
 	glGenBuffers(1, &m_vertexBufferLines);
 	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferLines);
+
+	// The dots change with every fragment, so they are streamed
+	glGenVertexArrays(1, &m_vertexArray);
+	glBindVertexArray(m_vertexArray);
+	glVertexAttribDivisor(1, 1);
+	glVertexAttribDivisor(2, 1);
+	glBindVertexArray(0);
+	m_dotStream = new StreamBuffer(GL_ARRAY_BUFFER, MAX_BATCH_DOTS * sizeof(Dot));
+	m_dots.reserve(MAX_BATCH_DOTS);
 }
 
 DotMaker::~DotMaker()
@@ -59,12 +82,24 @@ DotMaker::~DotMaker()
 
 	if(m_lineParts != NULL)
 		delete m_lineParts;
+
+	delete m_dotStream;
+	glDeleteVertexArrays(1, &m_vertexArray);
+	glDeleteBuffers(1, &m_vertexBufferLines);
+	glDeleteBuffers(1, &m_vertexBufferDot);
 }
 
 DotMaker* DotMaker::instance()
 {
-	static DotMaker maker = DotMaker();
-	return &maker;
+	if(dotMaker == NULL)
+		dotMaker = new DotMaker();
+	return dotMaker;
+}
+
+void DotMaker::release()
+{
+	delete dotMaker;
+	dotMaker = NULL;
 }
 
 void DotMaker::setScene(GLuint windowWidth, GLuint windowHeight, GLint radius, bool drawGitter)
@@ -72,7 +107,11 @@ void DotMaker::setScene(GLuint windowWidth, GLuint windowHeight, GLint radius, b
 	static GLint lastRadius = -1;
 	if(radius < 0) radius = 0;
 
-	if(radius != lastRadius)
+	// The dots collected so far belong to the last scene
+	flush();
+
+	// A new instance after release() has no buffers yet, whatever the last radius was
+	if(radius != lastRadius || m_dotParts == NULL)
 	{
 		lastRadius = radius;
 
@@ -92,52 +131,81 @@ void DotMaker::setScene(GLuint windowWidth, GLuint windowHeight, GLint radius, b
 	matrix[0] = 1.0f / m_windowWidthHalf;
 	matrix[5] = 1.0f / m_windowHeightHalf;
 
-	glUseProgram(m_shaderID);
+	// The dots are offset in window coordinates by the shader
+	matrix[12] = (-m_windowWidthHalf) * matrix[0];
+	matrix[13] = (-m_windowHeightHalf) * matrix[5];
 
 	if(drawGitter)
 	{
-		matrix[12] = (-m_windowWidthHalf) * matrix[0];
-		matrix[13] = (-m_windowHeightHalf) * matrix[5];
+		glUseProgram(m_shaderID);
+		glUniformMatrix4fv(m_matrixLocation, 1, GL_FALSE, matrix);
+		glBindVertexArray(m_vertexArray);
 
-		// Bind and send points in big point
-		glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferLines);
-
-		glUniform3f(glGetUniformLocation(m_shaderID, "uColorVec"), m_r, m_g, m_b);
-		glUniformMatrix4fv(glGetUniformLocation(m_shaderID, "uModelMatrix"), 1, GL_FALSE, matrix);
+		// The lines are not offset, and have the current color. flush() leaves
+		// attributes 1 and 2 enabled on the stream buffer, where they would win
+		glDisableVertexAttribArray(1);
+		glDisableVertexAttribArray(2);
+		glVertexAttrib2f(1, 0.0f, 0.0f);
+		glVertexAttrib3f(2, m_r, m_g, m_b);
 
 		glEnableVertexAttribArray(0);
 
 		glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferLines);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
 
-		glDrawArrays(GL_LINES, 0, m_numLineParts);
+		// Three floats per vertex
+		glDrawArrays(GL_LINES, 0, m_numLineParts / 3);
 
 		glDisableVertexAttribArray(0);
+		glBindVertexArray(0);
 	}
-
-	// Bind points in big point
-	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferDot);
 }
 
 void DotMaker::drawDot(GLint x, GLint y)
 {
-	x *= m_radius << 1;
-	y *= m_radius << 1;
+	Dot dot;
+	dot.x = (GLfloat)(x * (m_radius << 1));
+	dot.y = (GLfloat)(y * (m_radius << 1));
+	dot.r = m_r;
+	dot.g = m_g;
+	dot.b = m_b;
+	m_dots.push_back(dot);
+
+	if(m_dots.size() >= MAX_BATCH_DOTS)
+		flush();
+}
 
-	matrix[12] = ((GLfloat)x - m_windowWidthHalf) * matrix[0];
-	matrix[13] = ((GLfloat)y - m_windowHeightHalf) * matrix[5];
+void DotMaker::flush()
+{
+	if(m_dots.empty())
+		return;
 
-	glUniform3f(glGetUniformLocation(m_shaderID, "uColorVec"), m_r, m_g, m_b);
-	glUniformMatrix4fv(glGetUniformLocation(m_shaderID, "uModelMatrix"), 1, GL_FALSE, matrix);
+	GLintptr offset = 0;
+	Dot* dots = (Dot*)m_dotStream->map(m_dots.size() * sizeof(Dot), &offset);
+	std::copy(m_dots.begin(), m_dots.end(), dots);
+	m_dotStream->unmap();
 
-	glEnableVertexAttribArray(0);
+	glUseProgram(m_shaderID);
+	glUniformMatrix4fv(m_matrixLocation, 1, GL_FALSE, matrix);
+	glBindVertexArray(m_vertexArray);
 
 	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferDot);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glEnableVertexAttribArray(0);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_dotStream->buffer());
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Dot), (void*)(offset + offsetof(Dot, x)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Dot), (void*)(offset + offsetof(Dot, r)));
+	glEnableVertexAttribArray(2);
 
-	glDrawArrays(GL_POINTS, 0, m_numDotParts);
+	// Three floats per point of the dot
+	glDrawArraysInstanced(GL_POINTS, 0, m_numDotParts / 3, (GLsizei)m_dots.size());
 
-	glDisableVertexAttribArray(0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	m_dotStream->advance();
+	m_dots.clear();
 }
 
 void DotMaker::setColor(GLfloat r, GLfloat g, GLfloat b)
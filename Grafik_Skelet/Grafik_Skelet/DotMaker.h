@@ -23,6 +23,11 @@
 	#include <GL/glu.h>
 #endif
 
+#include <vector>
+
+#include "StreamBuffer.h"
+
+// drawDot() only collects the dots, they are drawn in batches with one instanced draw call
 class DotMaker
 {
 	private:
@@ -32,24 +37,41 @@ class DotMaker
 		~DotMaker();
 
 		static DotMaker* instance();
+		// Deletes the instance and its GL objects, call it before the GL context is destroyed
+		static void release();
 
 		void setScene(GLuint windowWidth, GLuint windowHeight, GLint radius, bool drawGitter);
 		void drawDot(GLint x, GLint y);
 		void setColor(GLfloat r, GLfloat g, GLfloat b);
+		// Draws the dots collected since the last batch
+		void flush();
 
 	private:
 		void generateDot(GLint radius);
 		void generateGitter(GLuint windowWidth, GLuint windowHeight, GLint radius);
 
+	private:
+		// A dot in window coordinates and its color
+		struct Dot
+		{
+			GLfloat x, y;
+			GLfloat r, g, b;
+		};
+
 	private:
 		GLfloat m_windowWidthHalf;
 		GLfloat m_windowHeightHalf;
 		GLint m_radius;
 
 		GLuint m_shaderID;
+		GLint m_matrixLocation;
+		GLuint m_vertexArray;
 		GLuint m_vertexBufferDot;
 		GLuint m_vertexBufferLines;
 
+		std::vector<Dot> m_dots;
+		StreamBuffer* m_dotStream;
+
 		GLfloat m_r, m_g, m_b;
 
 		GLfloat* m_dotParts;
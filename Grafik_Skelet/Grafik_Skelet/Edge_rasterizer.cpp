@@ -1,10 +1,14 @@
 #include "Edge_rasterizer.h"
 #include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdlib>
 #include "DotMaker.h"
 
 void Edge_rasterizer::init(int x1, int y1, int x2, int y2)
 {
 	this->two_edges = false;
+	this->interpolating = false;
 
 	this->x1 = x1;
 	this->y1 = y1;
@@ -18,6 +22,7 @@ void Edge_rasterizer::init(int x1, int y1, int x2, int y2)
 void Edge_rasterizer::init(int x1, int y1, int x2, int y2, int x3, int y3)
 {
 	this->two_edges = true;
+	this->interpolating = false;
 
 	this->x1 = x1;
 	this->y1 = y1;
@@ -31,6 +36,26 @@ void Edge_rasterizer::init(int x1, int y1, int x2, int y2, int x3, int y3)
 	this->init_edge(x1, y1, x2, y2);
 }
 
+void Edge_rasterizer::init(Raster_vertex const& v1, Raster_vertex const& v2)
+{
+	this->init(v1.x, v1.y, v2.x, v2.y);
+
+	this->interpolating = true;
+	this->init_interpolation(v1, v2);
+}
+
+void Edge_rasterizer::init(Raster_vertex const& v1, Raster_vertex const& v2, Raster_vertex const& v3)
+{
+	this->init(v1.x, v1.y, v2.x, v2.y, v3.x, v3.y);
+
+	// The vertices of the second edge are needed when the first edge is done
+	this->v2 = v2;
+	this->v3 = v3;
+
+	this->interpolating = true;
+	this->init_interpolation(v1, v2);
+}
+
 void Edge_rasterizer::init_edge(int x1, int y1, int x2, int y2)
 {
 	this->x_start = x1;
@@ -51,6 +76,16 @@ void Edge_rasterizer::init_edge(int x1, int y1, int x2, int y2)
 	this->Denominator = dy; // dy > 0 Assumption
 	this->Accumulator = (x_step > 0) ? Denominator : 1;
 
+	// Split the slope into a whole step and a remainder, so every scanline takes constant time
+	if (this->Denominator > 0) {
+		this->x_whole_step = (this->Numerator / this->Denominator) * this->x_step;
+		this->Remainder = this->Numerator % this->Denominator;
+	}
+	else {
+		this->x_whole_step = 0;
+		this->Remainder = 0;
+	}
+
 	this->valid = (this->y_current < this->y_stop);
 }
 
@@ -68,23 +103,66 @@ void Edge_rasterizer::next_fragment()
 		}
 		else {
 			this->init_edge(x2, y2, x3, y3);
+			if (this->interpolating) {
+				this->init_interpolation(this->v2, this->v3);
+			}
 			this->two_edges = false;
 		}
 	}
 	else {
 		this->update_edge();
+		if (this->interpolating) {
+			this->update_interpolation();
+		}
 	}
 }
 
 void Edge_rasterizer::update_edge()
 {
-	this->Accumulator += this->Numerator;
-	while (this->Accumulator > this->Denominator) {
+	// Same result as adding the Numerator and subtracting the Denominator until
+	// Accumulator <= Denominator, since the Accumulator stays in [1, Denominator]
+	this->x_current += this->x_whole_step;
+	this->Accumulator += this->Remainder;
+	if (this->Accumulator > this->Denominator) {
 		this->x_current += this->x_step;
 		this->Accumulator -= this->Denominator;
 	}
 }
 
+void Edge_rasterizer::init_interpolation(Raster_vertex const& v1, Raster_vertex const& v2)
+{
+	// Depth is linear in screen space, the attributes are only linear when divided by w
+	float inv_w1 = 1.0f / v1.w;
+	float inv_w2 = 1.0f / v2.w;
+
+	int edge_dy = v2.y - v1.y;
+	float inv_dy = (edge_dy > 0) ? 1.0f / float(edge_dy) : 0.0f;
+
+	this->z_current = v1.z;
+	this->z_step = (v2.z - v1.z) * inv_dy;
+
+	this->inv_w_current = inv_w1;
+	this->inv_w_step = (inv_w2 - inv_w1) * inv_dy;
+
+	// The attribute arrays have a fixed size, whatever the vertices claim
+	this->n_attributes = std::min(std::min(v1.num_attributes, v2.num_attributes), MAX_RASTER_ATTRIBUTES);
+	for (int i = 0; i < this->n_attributes; i++) {
+		float a1 = v1.attributes[i] * inv_w1;
+		float a2 = v2.attributes[i] * inv_w2;
+		this->attr_current[i] = a1;
+		this->attr_step[i] = (a2 - a1) * inv_dy;
+	}
+}
+
+void Edge_rasterizer::update_interpolation()
+{
+	this->z_current += this->z_step;
+	this->inv_w_current += this->inv_w_step;
+	for (int i = 0; i < this->n_attributes; i++) {
+		this->attr_current[i] += this->attr_step[i];
+	}
+}
+
 int Edge_rasterizer::x() const
 {
 	if (!this->valid) {
@@ -105,7 +183,48 @@ int Edge_rasterizer::y() const
 	return this->y_current;
 }
 
-Edge_rasterizer::Edge_rasterizer(void) : valid(false)
+float Edge_rasterizer::z() const
+{
+	if (!this->valid || !this->interpolating) {
+		throw std::runtime_error(
+			"edge_rasterizer::z(): Invalid State"
+		);
+	}
+	return this->z_current;
+}
+
+float Edge_rasterizer::inv_w() const
+{
+	if (!this->valid || !this->interpolating) {
+		throw std::runtime_error(
+			"edge_rasterizer::inv_w(): Invalid State"
+		);
+	}
+	return this->inv_w_current;
+}
+
+int Edge_rasterizer::num_attributes() const
+{
+	return this->interpolating ? this->n_attributes : 0;
+}
+
+float Edge_rasterizer::attribute_over_w(int i) const
+{
+	if (!this->valid || !this->interpolating || i < 0 || i >= this->n_attributes) {
+		throw std::runtime_error(
+			"edge_rasterizer::attribute_over_w(): Invalid State"
+		);
+	}
+	return this->attr_current[i];
+}
+
+float Edge_rasterizer::attribute(int i) const
+{
+	// Perspective correct value of the attribute
+	return this->attribute_over_w(i) / this->inv_w_current;
+}
+
+Edge_rasterizer::Edge_rasterizer(void) : valid(false), interpolating(false), n_attributes(0)
 {
 }
 
@@ -1,4 +1,6 @@
 #pragma once
+#include "Raster_vertex.h"
+
 class Edge_rasterizer
 {
 public:
@@ -8,11 +10,25 @@ public:
 	void init(int x1, int y1, int x2, int y2);
 	void init(int x1, int y1, int x2, int y2, int x3, int y3);
 
+	// Same as above, but the depth and attributes of the vertices are interpolated too
+	void init(Raster_vertex const& v1, Raster_vertex const& v2);
+	void init(Raster_vertex const& v1, Raster_vertex const& v2, Raster_vertex const& v3);
+
 	bool more_fragments() const;
 	void next_fragment();
 
 	int x() const;
 	int y() const;
+
+	// Unchecked versions of x() and y() for inner loops, only call them while more_fragments() is true
+	int x_unchecked() const { return this->x_current; }
+	int y_unchecked() const { return this->y_current; }
+
+	float z() const;
+	float inv_w() const;
+	int num_attributes() const;
+	float attribute_over_w(int i) const;
+	float attribute(int i) const;
 private:
 	int x1; int y1;
 	int x2; int y2;
@@ -35,5 +51,21 @@ private:
 	int Numerator;
 	int Denominator;
 	int Accumulator;
+	// Whole part of the slope, the remainder is handled by the Accumulator
+	int x_whole_step;
+	int Remainder;
+
+	// Interpolation of depth, 1/w and attribute/w along the edge
+	void init_interpolation(Raster_vertex const& v1, Raster_vertex const& v2);
+	void update_interpolation();
+
+	bool interpolating;
+	Raster_vertex v2; Raster_vertex v3;
+
+	int n_attributes;
+	float z_current; float z_step;
+	float inv_w_current; float inv_w_step;
+	float attr_current[MAX_RASTER_ATTRIBUTES];
+	float attr_step[MAX_RASTER_ATTRIBUTES];
 };
 
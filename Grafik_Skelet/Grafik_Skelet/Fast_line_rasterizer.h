@@ -0,0 +1,311 @@
+#pragma once
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+	#include <emmintrin.h>
+	#define FAST_LINE_RASTERIZER_SSE2
+#endif
+
+#include "Fragment_sink.h"
+
+/**
+* Header-only version of Line_rasterizer. The inner loop is instantiated for
+* each octant and for the fragment sink type, so there is no per-fragment
+* dispatch through a member function pointer or a singleton, and the sink
+* (see Fragment_sink.h) is inlined into the loop.
+*
+* The fragments are exactly the ones produced by Line_rasterizer: every
+* point from (x1, y1) to (x2, y2) inclusive, and none if the points are equal.
+*
+* rasterize_runs() produces the same fragments, but as whole horizontal or
+* vertical runs, computing the length of each run with one division instead
+* of stepping pixel by pixel. Lines closer to the diagonal than 1:3 are still
+* stepped pixel by pixel since their runs are too short to pay for the division.
+*
+* rasterize_lines() rasterizes a batch of lines as runs; the lines are
+* classified by octant four at a time with SSE2 and then rasterized octant
+* by octant, so each inner loop runs for many lines in a row.
+*
+* rasterize_antialiased() draws a line between sub-pixel endpoints with
+* Xiaolin Wu's algorithm. Every column (or row, for steep lines) gets two
+* fragments whose coverages 0..255 add up to 255, and the inner loop only
+* uses 16.16 fixed point integer arithmetic.
+*/
+class Fast_line_rasterizer
+{
+public:
+	template <class Sink>
+	static void rasterize(int x1, int y1, int x2, int y2, Sink& sink)
+	{
+		dispatch<false>(classify(x1, y1, x2, y2), x1, y1, x2, y2, sink);
+	}
+
+	template <class Sink>
+	static void rasterize_runs(int x1, int y1, int x2, int y2, Sink& sink)
+	{
+		dispatch<true>(classify(x1, y1, x2, y2), x1, y1, x2, y2, sink);
+	}
+
+	// endpoints holds num_lines lines as x1, y1, x2, y2. The order in which
+	// the lines are rasterized is not the order in which they are given.
+	template <class Sink>
+	static void rasterize_lines(int const* endpoints, int num_lines, Sink& sink)
+	{
+		std::vector<int> octants[NUM_OCTANTS];
+		int n = 0;
+
+#ifdef FAST_LINE_RASTERIZER_SSE2
+		for (; n + 4 <= num_lines; n += 4) {
+			// Transpose four lines into x1, y1, x2 and y2 vectors
+			__m128i l0 = _mm_loadu_si128((__m128i const*)(endpoints + 4 * n));
+			__m128i l1 = _mm_loadu_si128((__m128i const*)(endpoints + 4 * n + 4));
+			__m128i l2 = _mm_loadu_si128((__m128i const*)(endpoints + 4 * n + 8));
+			__m128i l3 = _mm_loadu_si128((__m128i const*)(endpoints + 4 * n + 12));
+			__m128i t0 = _mm_unpacklo_epi32(l0, l1);
+			__m128i t1 = _mm_unpacklo_epi32(l2, l3);
+			__m128i t2 = _mm_unpackhi_epi32(l0, l1);
+			__m128i t3 = _mm_unpackhi_epi32(l2, l3);
+			__m128i x1 = _mm_unpacklo_epi64(t0, t1);
+			__m128i y1 = _mm_unpackhi_epi64(t0, t1);
+			__m128i x2 = _mm_unpacklo_epi64(t2, t3);
+			__m128i y2 = _mm_unpackhi_epi64(t2, t3);
+
+			__m128i zero = _mm_setzero_si128();
+			__m128i dx = _mm_sub_epi32(x2, x1);
+			__m128i dy = _mm_sub_epi32(y2, y1);
+			__m128i x_negative = _mm_cmplt_epi32(dx, zero);
+			__m128i y_negative = _mm_cmplt_epi32(dy, zero);
+			__m128i abs_dx = _mm_sub_epi32(_mm_xor_si128(dx, x_negative), x_negative);
+			__m128i abs_dy = _mm_sub_epi32(_mm_xor_si128(dy, y_negative), y_negative);
+			__m128i x_dominant = _mm_cmpgt_epi32(abs_dx, abs_dy);
+			__m128i empty = _mm_andnot_si128(x_dominant, _mm_cmpeq_epi32(dy, zero));
+
+			int x_dominant_bits = _mm_movemask_ps(_mm_castsi128_ps(x_dominant));
+			int x_negative_bits = _mm_movemask_ps(_mm_castsi128_ps(x_negative));
+			int y_negative_bits = _mm_movemask_ps(_mm_castsi128_ps(y_negative));
+			int empty_bits = _mm_movemask_ps(_mm_castsi128_ps(empty));
+
+			for (int i = 0; i < 4; i++) {
+				if (!((empty_bits >> i) & 1)) {
+					int octant = (((x_dominant_bits >> i) & 1) << 2) |
+								 (((x_negative_bits >> i) & 1) << 1) |
+								 ((y_negative_bits >> i) & 1);
+					octants[octant].push_back(n + i);
+				}
+			}
+		}
+#endif
+		for (; n < num_lines; n++) {
+			int const* line = endpoints + 4 * n;
+			int octant = classify(line[0], line[1], line[2], line[3]);
+			if (octant != EMPTY) {
+				octants[octant].push_back(n);
+			}
+		}
+
+		for (int octant = 0; octant < NUM_OCTANTS; octant++) {
+			std::vector<int> const& lines = octants[octant];
+			for (size_t i = 0; i < lines.size(); i++) {
+				int const* line = endpoints + 4 * lines[i];
+				dispatch<true>(octant, line[0], line[1], line[2], line[3], sink);
+			}
+		}
+	}
+
+	// The sink needs a member function void coverage(int x, int y, int alpha)
+	template <class Sink>
+	static void rasterize_antialiased(float x1, float y1, float x2, float y2, Sink& sink)
+	{
+		if (std::fabs(y2 - y1) > std::fabs(x2 - x1)) {
+			wu<true>(y1, x1, y2, x2, sink);
+		}
+		else {
+			wu<false>(x1, y1, x2, y2, sink);
+		}
+	}
+
+private:
+	// Xiaolin Wu's line algorithm, a is the major axis and b the minor axis
+	template <bool STEEP, class Sink>
+	static void wu(float a1, float b1, float a2, float b2, Sink& sink)
+	{
+		if (a1 > a2) {
+			std::swap(a1, a2);
+			std::swap(b1, b2);
+		}
+		float da = a2 - a1;
+		float gradient = (da > 0.0f) ? (b2 - b1) / da : 1.0f;
+
+		// The endpoints are weighted by how much of their pixel the line covers
+		int a_start = int(std::floor(a1 + 0.5f));
+		float b_start = b1 + gradient * (float(a_start) - a1);
+		float gap_start = 1.0f - fraction(a1 + 0.5f);
+		wu_pair<STEEP>(a_start, b_start, gap_start, sink);
+
+		int a_stop = int(std::floor(a2 + 0.5f));
+		float b_stop = b2 + gradient * (float(a_stop) - a2);
+		float gap_stop = fraction(a2 + 0.5f);
+		if (a_stop != a_start) {
+			wu_pair<STEEP>(a_stop, b_stop, gap_stop, sink);
+		}
+
+		// The minor coordinate in 16.16 fixed point
+		int b_fixed = int(std::floor((b_start + gradient) * 65536.0f + 0.5f));
+		int gradient_fixed = int(std::floor(gradient * 65536.0f + 0.5f));
+		for (int a = a_start + 1; a < a_stop; a++) {
+			int b = b_fixed >> 16;
+			int alpha = (b_fixed >> 8) & 0xff;
+			plot<STEEP>(a, b, 255 - alpha, sink);
+			plot<STEEP>(a, b + 1, alpha, sink);
+			b_fixed += gradient_fixed;
+		}
+	}
+
+	template <bool STEEP, class Sink>
+	static void wu_pair(int a, float b, float weight, Sink& sink)
+	{
+		int b_whole = int(std::floor(b));
+		float b_fraction = b - float(b_whole);
+		plot<STEEP>(a, b_whole, int((1.0f - b_fraction) * weight * 255.0f + 0.5f), sink);
+		plot<STEEP>(a, b_whole + 1, int(b_fraction * weight * 255.0f + 0.5f), sink);
+	}
+
+	template <bool STEEP, class Sink>
+	static void plot(int a, int b, int alpha, Sink& sink)
+	{
+		if (alpha > 0) {
+			if (STEEP)	sink.coverage(b, a, alpha);
+			else		sink.coverage(a, b, alpha);
+		}
+	}
+
+	static float fraction(float x)
+	{
+		return x - std::floor(x);
+	}
+
+	// Octants are numbered by x-dominance (bit 2), dx < 0 (bit 1) and dy < 0 (bit 0)
+	static const int NUM_OCTANTS = 8;
+	static const int EMPTY = NUM_OCTANTS;
+	static const int MIN_RUN_LENGTH = 3;
+
+	static int classify(int x1, int y1, int x2, int y2)
+	{
+		int dx = x2 - x1;
+		int dy = y2 - y1;
+		bool x_dominant = (std::abs(dx) > std::abs(dy));
+		if (!x_dominant && dy == 0) {
+			return EMPTY;
+		}
+		return (x_dominant ? 4 : 0) | ((dx < 0) ? 2 : 0) | ((dy < 0) ? 1 : 0);
+	}
+
+	// Selects the pixel loop or the run loop at compile time, so sinks which are
+	// only used with rasterize() do not need the run member functions
+	template <bool RUNS> struct Runs {};
+
+	template <bool RUNS, class Sink>
+	static void dispatch(int octant, int x1, int y1, int x2, int y2, Sink& sink)
+	{
+		Runs<RUNS> runs;
+		switch (octant) {
+		case 0: line<false,  1,  1>(x1, y1, x2, y2, sink, runs); break;
+		case 1: line<false,  1, -1>(x1, y1, x2, y2, sink, runs); break;
+		case 2: line<false, -1,  1>(x1, y1, x2, y2, sink, runs); break;
+		case 3: line<false, -1, -1>(x1, y1, x2, y2, sink, runs); break;
+		case 4: line<true,   1,  1>(x1, y1, x2, y2, sink, runs); break;
+		case 5: line<true,   1, -1>(x1, y1, x2, y2, sink, runs); break;
+		case 6: line<true,  -1,  1>(x1, y1, x2, y2, sink, runs); break;
+		case 7: line<true,  -1, -1>(x1, y1, x2, y2, sink, runs); break;
+		default: break;
+		}
+	}
+
+	template <bool X_DOMINANT, int X_STEP, int Y_STEP, class Sink>
+	static void line(int x1, int y1, int x2, int y2, Sink& sink, Runs<false>)
+	{
+		// Walk along the major axis (a) and step the minor axis (b)
+		const int A_STEP = X_DOMINANT ? X_STEP : Y_STEP;
+		const int B_STEP = X_DOMINANT ? Y_STEP : X_STEP;
+
+		int a = X_DOMINANT ? x1 : y1;
+		int b = X_DOMINANT ? y1 : x1;
+		int a_stop = X_DOMINANT ? x2 : y2;
+		int abs_2da = std::abs(X_DOMINANT ? (x2 - x1) : (y2 - y1)) << 1;
+		int abs_2db = std::abs(X_DOMINANT ? (y2 - y1) : (x2 - x1)) << 1;
+
+		// Ties are broken towards the minor axis when stepping left to right,
+		// so the minor axis is stepped when d >= threshold
+		const int threshold = (A_STEP > 0) ? 0 : 1;
+		int d = abs_2db - (abs_2da >> 1);
+
+		for (;;) {
+			if (X_DOMINANT) sink.fragment(a, b);
+			else			sink.fragment(b, a);
+			if (a == a_stop) break;
+			if (d >= threshold) {
+				b += B_STEP;
+				d -= abs_2da;
+			}
+			a += A_STEP;
+			d += abs_2db;
+		}
+	}
+
+	template <bool X_DOMINANT, int X_STEP, int Y_STEP, class Sink>
+	static void line(int x1, int y1, int x2, int y2, Sink& sink, Runs<true>)
+	{
+		const int A_STEP = X_DOMINANT ? X_STEP : Y_STEP;
+		const int B_STEP = X_DOMINANT ? Y_STEP : X_STEP;
+
+		int a = X_DOMINANT ? x1 : y1;
+		int b = X_DOMINANT ? y1 : x1;
+		int a_stop = X_DOMINANT ? x2 : y2;
+		int abs_2da = std::abs(X_DOMINANT ? (x2 - x1) : (y2 - y1)) << 1;
+		int abs_2db = std::abs(X_DOMINANT ? (y2 - y1) : (x2 - x1)) << 1;
+
+		// Runs shorter than MIN_RUN_LENGTH on average are cheaper to step pixel by pixel
+		if (abs_2da < MIN_RUN_LENGTH * abs_2db) {
+			line<X_DOMINANT, X_STEP, Y_STEP>(x1, y1, x2, y2, sink, Runs<false>());
+			return;
+		}
+
+		const int threshold = (A_STEP > 0) ? 0 : 1;
+		int d = abs_2db - (abs_2da >> 1);
+
+		for (;;) {
+			// The run ends at the first pixel where d + k * abs_2db >= threshold
+			int remaining = (a_stop - a) * A_STEP;
+			int k = remaining;
+			if (d >= threshold) {
+				k = 0;
+			}
+			else if (abs_2db > 0) {
+				k = (threshold - d + abs_2db - 1) / abs_2db;
+			}
+			if (k >= remaining) {
+				run<X_DOMINANT>(a, a_stop, b, sink);
+				break;
+			}
+			run<X_DOMINANT>(a, a + k * A_STEP, b, sink);
+
+			a += (k + 1) * A_STEP;
+			b += B_STEP;
+			d += (k + 1) * abs_2db - abs_2da;
+		}
+	}
+
+	template <bool X_DOMINANT, class Sink>
+	static void run(int a_start, int a_stop, int b, Sink& sink)
+	{
+		if (a_start > a_stop) {
+			std::swap(a_start, a_stop);
+		}
+		if (X_DOMINANT) sink.horizontal_run(a_start, a_stop, b);
+		else			sink.vertical_run(b, a_start, a_stop);
+	}
+};
+
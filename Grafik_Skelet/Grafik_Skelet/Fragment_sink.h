@@ -0,0 +1,139 @@
+#pragma once
+#include <vector>
+
+#include "DotMaker.h"
+#include "Frame_buffer.h"
+
+/**
+* Fragment sinks receive the fragments produced by the templated rasterizers
+* in Fast_line_rasterizer.h. A sink is any type with a member function
+* void fragment(int x, int y), which is inlined into the inner loop.
+* Sinks used with the run-slice functions also need the member functions
+* void horizontal_run(int x_start, int x_stop, int y) and
+* void vertical_run(int x, int y_start, int y_stop), where the runs are
+* inclusive and start <= stop. The anti-aliased rasterizer calls
+* void coverage(int x, int y, int alpha) with alpha in [0, 255].
+*/
+
+// Draws every fragment as a dot, like Line_rasterizer::next_fragment()
+struct Dot_sink
+{
+	void fragment(int x, int y)
+	{
+		DotMaker::instance()->drawDot(x, y);
+	}
+
+	void horizontal_run(int x_start, int x_stop, int y)
+	{
+		for (int x = x_start; x <= x_stop; x++) {
+			DotMaker::instance()->drawDot(x, y);
+		}
+	}
+
+	void vertical_run(int x, int y_start, int y_stop)
+	{
+		for (int y = y_start; y <= y_stop; y++) {
+			DotMaker::instance()->drawDot(x, y);
+		}
+	}
+};
+
+// Writes every fragment into a Frame_buffer with one color
+struct Frame_buffer_sink
+{
+	Frame_buffer_sink(Frame_buffer* buffer, unsigned int color) : buffer(buffer), color(color) {}
+
+	void fragment(int x, int y)
+	{
+		this->buffer->set_pixel(x, y, this->color);
+	}
+
+	void horizontal_run(int x_start, int x_stop, int y)
+	{
+		this->buffer->fill_horizontal(x_start, x_stop, y, this->color);
+	}
+
+	void vertical_run(int x, int y_start, int y_stop)
+	{
+		this->buffer->fill_vertical(x, y_start, y_stop, this->color);
+	}
+
+	void coverage(int x, int y, int alpha)
+	{
+		this->buffer->blend_pixel(x, y, this->color, alpha);
+	}
+
+	Frame_buffer* buffer;
+	unsigned int color;
+};
+
+// Only counts the fragments
+struct Counting_sink
+{
+	Counting_sink() : count(0) {}
+
+	void fragment(int, int)
+	{
+		this->count++;
+	}
+
+	void horizontal_run(int x_start, int x_stop, int)
+	{
+		this->count += x_stop - x_start + 1;
+	}
+
+	void vertical_run(int, int y_start, int y_stop)
+	{
+		this->count += y_stop - y_start + 1;
+	}
+
+	void coverage(int, int, int)
+	{
+		this->count++;
+	}
+
+	long count;
+};
+
+// A horizontal run of fragments [x_start, x_stop] on scanline y
+struct Span
+{
+	int x_start;
+	int x_stop;
+	int y;
+};
+
+// Merges consecutive fragments on the same scanline into spans
+struct Span_sink
+{
+	void fragment(int x, int y)
+	{
+		if (!this->spans.empty()) {
+			Span& last = this->spans.back();
+			if (last.y == y && (x == last.x_stop + 1 || x == last.x_start - 1)) {
+				if (x > last.x_stop) last.x_stop = x;
+				else last.x_start = x;
+				return;
+			}
+		}
+		Span span = { x, x, y };
+		this->spans.push_back(span);
+	}
+
+	void horizontal_run(int x_start, int x_stop, int y)
+	{
+		Span span = { x_start, x_stop, y };
+		this->spans.push_back(span);
+	}
+
+	void vertical_run(int x, int y_start, int y_stop)
+	{
+		for (int y = y_start; y <= y_stop; y++) {
+			Span span = { x, x, y };
+			this->spans.push_back(span);
+		}
+	}
+
+	std::vector<Span> spans;
+};
+
@@ -0,0 +1,112 @@
+#include "Frame_buffer.h"
+#include <algorithm>
+#include <cstdio>
+
+Frame_buffer::Frame_buffer(int width, int height) : buffer_width(0), buffer_height(0)
+{
+	this->resize(width, height);
+}
+
+Frame_buffer::~Frame_buffer()
+{
+}
+
+void Frame_buffer::resize(int width, int height)
+{
+	this->buffer_width = std::max(width, 0);
+	this->buffer_height = std::max(height, 0);
+	this->pixels.assign(this->buffer_width * this->buffer_height, 0);
+}
+
+void Frame_buffer::clear(unsigned int color)
+{
+	std::fill(this->pixels.begin(), this->pixels.end(), color);
+}
+
+unsigned int Frame_buffer::pack(int r, int g, int b, int a)
+{
+	return (unsigned int)(r & 0xff) |
+		   ((unsigned int)(g & 0xff) << 8) |
+		   ((unsigned int)(b & 0xff) << 16) |
+		   ((unsigned int)(a & 0xff) << 24);
+}
+
+unsigned int Frame_buffer::pack(float r, float g, float b, float a)
+{
+	// Clamp to [0, 1] and round to 8 bits
+	return pack(int(std::min(std::max(r, 0.0f), 1.0f) * 255.0f + 0.5f),
+				int(std::min(std::max(g, 0.0f), 1.0f) * 255.0f + 0.5f),
+				int(std::min(std::max(b, 0.0f), 1.0f) * 255.0f + 0.5f),
+				int(std::min(std::max(a, 0.0f), 1.0f) * 255.0f + 0.5f));
+}
+
+void Frame_buffer::fill_horizontal(int x_start, int x_stop, int y, unsigned int color)
+{
+	if (y < 0 || y >= this->buffer_height) {
+		return;
+	}
+	x_start = std::max(x_start, 0);
+	x_stop = std::min(x_stop, this->buffer_width - 1);
+	if (x_start <= x_stop) {
+		unsigned int* row = &this->pixels[y * this->buffer_width];
+		std::fill(row + x_start, row + x_stop + 1, color);
+	}
+}
+
+void Frame_buffer::fill_vertical(int x, int y_start, int y_stop, unsigned int color)
+{
+	if (x < 0 || x >= this->buffer_width) {
+		return;
+	}
+	y_start = std::max(y_start, 0);
+	y_stop = std::min(y_stop, this->buffer_height - 1);
+	for (int y = y_start; y <= y_stop; y++) {
+		this->pixels[y * this->buffer_width + x] = color;
+	}
+}
+
+unsigned int Frame_buffer::blend(unsigned int destination, unsigned int source, int alpha)
+{
+	// Map alpha to [0, 256] so the division by 255 becomes a shift, and blend
+	// red/blue and green/alpha as two pairs of channels at a time
+	unsigned int a = (unsigned int)(alpha + (alpha >> 7));
+	unsigned int inv_a = 256 - a;
+
+	unsigned int rb = ((source & 0x00ff00ff) * a + (destination & 0x00ff00ff) * inv_a) >> 8;
+	unsigned int ga = (((source >> 8) & 0x00ff00ff) * a + ((destination >> 8) & 0x00ff00ff) * inv_a) >> 8;
+
+	return (rb & 0x00ff00ff) | ((ga & 0x00ff00ff) << 8);
+}
+
+unsigned int Frame_buffer::pixel(int x, int y) const
+{
+	return this->pixels[y * this->buffer_width + x];
+}
+
+unsigned int* Frame_buffer::data() { return this->pixels.empty() ? 0 : &this->pixels[0]; }
+unsigned int const* Frame_buffer::data() const { return this->pixels.empty() ? 0 : &this->pixels[0]; }
+
+int Frame_buffer::width() const { return this->buffer_width; }
+int Frame_buffer::height() const { return this->buffer_height; }
+
+bool Frame_buffer::write_ppm(std::string const& filename) const
+{
+	FILE* file = fopen(filename.c_str(), "wb");
+	if (file == NULL) {
+		return false;
+	}
+	fprintf(file, "P6\n%d %d\n255\n", this->buffer_width, this->buffer_height);
+
+	std::vector<unsigned char> row(this->buffer_width * 3);
+	bool ok = true;
+	for (int y = this->buffer_height - 1; y >= 0 && ok; y--) {
+		unsigned int const* pixel = &this->pixels[y * this->buffer_width];
+		for (int x = 0; x < this->buffer_width; x++) {
+			row[3 * x + 0] = (unsigned char)(pixel[x] & 0xff);
+			row[3 * x + 1] = (unsigned char)((pixel[x] >> 8) & 0xff);
+			row[3 * x + 2] = (unsigned char)((pixel[x] >> 16) & 0xff);
+		}
+		ok = row.empty() || fwrite(&row[0], 1, row.size(), file) == row.size();
+	}
+	return fclose(file) == 0 && ok;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <string>
+#include <vector>
+
+/**
+* An RGBA color buffer with 8 bits per channel for the software rasterizer.
+* The colors are packed into an unsigned int with red in the lowest byte,
+* so the bytes are in RGBA order in memory.
+*/
+class Frame_buffer
+{
+public:
+	Frame_buffer(int width, int height);
+	virtual ~Frame_buffer();
+
+	void resize(int width, int height);
+	void clear(unsigned int color);
+
+	static unsigned int pack(int r, int g, int b, int a);
+	static unsigned int pack(float r, float g, float b, float a);
+
+	// Pixels outside the buffer are ignored
+	void set_pixel(int x, int y, unsigned int color)
+	{
+		if (x >= 0 && y >= 0 && x < this->buffer_width && y < this->buffer_height) {
+			this->pixels[y * this->buffer_width + x] = color;
+		}
+	}
+	// Blends color over the pixel with alpha in [0, 255], pixels outside the buffer are ignored
+	void blend_pixel(int x, int y, unsigned int color, int alpha)
+	{
+		if (x >= 0 && y >= 0 && x < this->buffer_width && y < this->buffer_height) {
+			unsigned int& pixel = this->pixels[y * this->buffer_width + x];
+			pixel = blend(pixel, color, alpha);
+		}
+	}
+	static unsigned int blend(unsigned int destination, unsigned int source, int alpha);
+
+	unsigned int pixel(int x, int y) const;
+
+	// Fill the inclusive runs [x_start, x_stop] on row y and [y_start, y_stop] on column x
+	void fill_horizontal(int x_start, int x_stop, int y, unsigned int color);
+	void fill_vertical(int x, int y_start, int y_stop, unsigned int color);
+
+	unsigned int* data();
+	unsigned int const* data() const;
+
+	int width() const;
+	int height() const;
+
+	// Writes the colors as a binary PPM image with the top row first, since row 0
+	// is the bottom row like in OpenGL. Returns false if the file cannot be written.
+	bool write_ppm(std::string const& filename) const;
+private:
+	int buffer_width;
+	int buffer_height;
+
+	std::vector<unsigned int> pixels;
+};
+
@@ -0,0 +1,121 @@
+#include "Frame_scheduler.h"
+
+Frame_scheduler::Frame_scheduler(void) : dirty(true), rate(0), poll(0), next_frame(0), next_frame_remainder(0)
+{
+}
+
+Frame_scheduler::~Frame_scheduler(void)
+{
+}
+
+void Frame_scheduler::animation_rate(int frames_per_second)
+{
+	this->rate = frames_per_second > 0 ? frames_per_second : 0;
+	this->next_frame = SDL_GetTicks();
+	this->next_frame_remainder = 0;
+	this->dirty = true;
+}
+
+int Frame_scheduler::animation_rate() const
+{
+	return this->rate;
+}
+
+void Frame_scheduler::poll_interval(int milliseconds)
+{
+	this->poll = milliseconds > 0 ? milliseconds : 0;
+}
+
+void Frame_scheduler::invalidate()
+{
+	this->dirty = true;
+}
+
+void Frame_scheduler::update_animation(Uint32 now)
+{
+	// Wrap-around safe check of now >= next_frame
+	if (this->rate > 0 && (Sint32)(now - this->next_frame) >= 0) {
+		this->dirty = true;
+	}
+}
+
+bool Frame_scheduler::wait_event(SDL_Event* event)
+{
+	Uint32 now = SDL_GetTicks();
+	this->update_animation(now);
+
+	int timeout = -1;
+	if (this->rate > 0) {
+		timeout = (int)(this->next_frame - now);
+	}
+	if (this->poll > 0 && (timeout < 0 || this->poll < timeout)) {
+		timeout = this->poll;
+	}
+
+	int result;
+	if (this->dirty) {
+		result = SDL_PollEvent(event);
+	}
+	else if (timeout >= 0) {
+		result = SDL_WaitEventTimeout(event, timeout);
+	}
+	else {
+		result = SDL_WaitEvent(event);
+	}
+
+	if (result == 0) {
+		return false;
+	}
+	this->handle_event(*event);
+	return true;
+}
+
+bool Frame_scheduler::poll_event(SDL_Event* event)
+{
+	if (SDL_PollEvent(event) == 0) {
+		return false;
+	}
+	this->handle_event(*event);
+	return true;
+}
+
+void Frame_scheduler::handle_event(SDL_Event const& event)
+{
+	if (event.type == SDL_WINDOWEVENT) {
+		switch (event.window.event) {
+		case SDL_WINDOWEVENT_SHOWN:
+		case SDL_WINDOWEVENT_EXPOSED:
+		case SDL_WINDOWEVENT_RESIZED:
+		case SDL_WINDOWEVENT_SIZE_CHANGED:
+		case SDL_WINDOWEVENT_MAXIMIZED:
+		case SDL_WINDOWEVENT_RESTORED:
+			this->dirty = true;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+bool Frame_scheduler::frame_due()
+{
+	this->update_animation(SDL_GetTicks());
+	return this->dirty;
+}
+
+void Frame_scheduler::frame_drawn()
+{
+	this->dirty = false;
+	if (this->rate == 0) {
+		return;
+	}
+
+	// Step the frame time by 1000/rate ms, but skip the frames that were
+	// missed instead of drawing them in a burst
+	Uint32 now = SDL_GetTicks();
+	do {
+		this->next_frame_remainder += 1000;
+		this->next_frame += this->next_frame_remainder / this->rate;
+		this->next_frame_remainder %= this->rate;
+	} while ((Sint32)(now - this->next_frame) >= 0);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <SDL2/SDL.h>
+
+/**
+* Decides when the main loop draws a frame, so the program sleeps in
+* SDL_WaitEventTimeout instead of redrawing an unchanged scene continuously.
+*
+* A frame is drawn when the scene has been invalidated, e.g. by input or by
+* the window being exposed or resized. With an animation rate the scene is
+* also invalidated at that fixed rate, and the loop sleeps between the frames.
+*/
+class Frame_scheduler
+{
+public:
+	Frame_scheduler(void);
+	virtual ~Frame_scheduler(void);
+
+	// Frames per second of the animation, 0 only draws when the scene is invalidated
+	void animation_rate(int frames_per_second);
+	int animation_rate() const;
+
+	// Wakes wait_event() up at least this often in milliseconds to check for other work, 0 never
+	void poll_interval(int milliseconds);
+
+	// Requests a new frame, because the scene, the camera or the window changed
+	void invalidate();
+
+	// Waits until an event arrives or the next frame is due. Returns true if
+	// event was filled, and invalidates the scene for window events which need a redraw.
+	bool wait_event(SDL_Event* event);
+	// Like wait_event() without waiting, for the events which are already queued
+	bool poll_event(SDL_Event* event);
+
+	// Returns true if a frame should be drawn now, call frame_drawn() after drawing it
+	bool frame_due();
+	void frame_drawn();
+private:
+	void update_animation(Uint32 now);
+	// Invalidates the scene for window events which need a redraw
+	void handle_event(SDL_Event const& event);
+
+	bool dirty;
+	int rate;
+	int poll;
+	// Time of the next animation frame in milliseconds, kept in 1/rate ms steps to avoid drift
+	Uint32 next_frame;
+	Uint32 next_frame_remainder;
+};
+
@@ -0,0 +1,189 @@
+#include "Frame_writer.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+Frame_writer::Frame_writer(std::string const& output, Format format, int frame_rate, int max_queued)
+	: output(output), format(format), frame_rate(frame_rate), max_queued(max_queued < 1 ? 1 : max_queued),
+	  stream(NULL), stream_width(0), stream_height(0),
+	  frames_done(0), busy(false), failed(false), stopping(false)
+{
+	this->worker = std::thread(&Frame_writer::run, this);
+}
+
+Frame_writer::~Frame_writer()
+{
+	this->finish();
+	{
+		std::unique_lock<std::mutex> guard(this->lock);
+		this->stopping = true;
+	}
+	this->not_empty.notify_all();
+	this->worker.join();
+
+	if (this->stream != NULL) {
+		fclose(this->stream);
+	}
+	for (size_t i = 0; i < this->all_buffers.size(); i++) {
+		delete this->all_buffers[i];
+	}
+}
+
+Frame_buffer* Frame_writer::acquire(int width, int height)
+{
+	std::unique_lock<std::mutex> guard(this->lock);
+	while ((int)this->queue.size() >= this->max_queued) {
+		this->not_full.wait(guard);
+	}
+
+	Frame_buffer* buffer;
+	if (this->free_buffers.empty()) {
+		buffer = new Frame_buffer(width, height);
+		this->all_buffers.push_back(buffer);
+	}
+	else {
+		buffer = this->free_buffers.back();
+		this->free_buffers.pop_back();
+		if (buffer->width() != width || buffer->height() != height) {
+			buffer->resize(width, height);
+		}
+	}
+	return buffer;
+}
+
+void Frame_writer::write(Frame_buffer const& frame)
+{
+	this->write(frame.data(), frame.width(), frame.height());
+}
+
+void Frame_writer::write(unsigned int const* pixels, int width, int height)
+{
+	// The copy is made outside the lock, so the thread keeps writing meanwhile
+	Frame_buffer* buffer = this->acquire(width, height);
+	if (width > 0 && height > 0) {
+		memcpy(buffer->data(), pixels, sizeof(unsigned int) * width * height);
+	}
+
+	{
+		std::unique_lock<std::mutex> guard(this->lock);
+		this->queue.push_back(buffer);
+	}
+	this->not_empty.notify_one();
+}
+
+bool Frame_writer::finish()
+{
+	std::unique_lock<std::mutex> guard(this->lock);
+	while (!this->queue.empty() || this->busy) {
+		this->not_full.wait(guard);
+	}
+	if (this->stream != NULL) {
+		fflush(this->stream);
+	}
+	return !this->failed;
+}
+
+int Frame_writer::frames_written() const
+{
+	std::unique_lock<std::mutex> guard(this->lock);
+	return this->frames_done;
+}
+
+void Frame_writer::run()
+{
+	std::unique_lock<std::mutex> guard(this->lock);
+	for (;;) {
+		while (this->queue.empty() && !this->stopping) {
+			this->not_empty.wait(guard);
+		}
+		if (this->queue.empty()) {
+			return;
+		}
+
+		Frame_buffer* buffer = this->queue.front();
+		this->queue.pop_front();
+		int index = this->frames_done;
+		this->busy = true;
+
+		guard.unlock();
+		bool ok = this->write_frame(*buffer, index);
+		guard.lock();
+
+		this->busy = false;
+		this->failed = this->failed || !ok;
+		this->frames_done++;
+		this->free_buffers.push_back(buffer);
+		this->not_full.notify_all();
+	}
+}
+
+bool Frame_writer::write_frame(Frame_buffer const& frame, int index)
+{
+	if (this->format == Y4M_STREAM) {
+		return this->write_y4m(frame);
+	}
+
+	std::ostringstream filename;
+	filename << this->output;
+	filename.width(4);
+	filename.fill('0');
+	filename << index << ".ppm";
+	return frame.write_ppm(filename.str());
+}
+
+bool Frame_writer::write_y4m(Frame_buffer const& frame)
+{
+	int width = frame.width();
+	int height = frame.height();
+
+	if (this->stream == NULL) {
+		this->stream = fopen((this->output + ".y4m").c_str(), "wb");
+		if (this->stream == NULL) {
+			return false;
+		}
+		fprintf(this->stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, this->frame_rate);
+		this->stream_width = width;
+		this->stream_height = height;
+	}
+	// All frames of a stream must have the same size
+	if (width != this->stream_width || height != this->stream_height) {
+		return false;
+	}
+
+	// Full range BT.601 with 8 bit fixed point weights, chroma averaged over 2x2 pixels
+	int chroma_width = (width + 1) / 2;
+	int chroma_height = (height + 1) / 2;
+	this->planes.resize(width * height + 2 * chroma_width * chroma_height);
+	unsigned char* y_plane = &this->planes[0];
+	unsigned char* u_plane = y_plane + width * height;
+	unsigned char* v_plane = u_plane + chroma_width * chroma_height;
+
+	for (int y = 0; y < height; y++) {
+		// Rows are stored bottom to top
+		unsigned int const* row = frame.data() + (height - 1 - y) * width;
+		for (int x = 0; x < width; x++) {
+			int r = row[x] & 0xff; int g = (row[x] >> 8) & 0xff; int b = (row[x] >> 16) & 0xff;
+			y_plane[y * width + x] = (unsigned char)((77 * r + 150 * g + 29 * b + 128) >> 8);
+		}
+	}
+	for (int cy = 0; cy < chroma_height; cy++) {
+		for (int cx = 0; cx < chroma_width; cx++) {
+			int r = 0; int g = 0; int b = 0; int n = 0;
+			for (int y = 2 * cy; y < 2 * cy + 2 && y < height; y++) {
+				unsigned int const* row = frame.data() + (height - 1 - y) * width;
+				for (int x = 2 * cx; x < 2 * cx + 2 && x < width; x++) {
+					r += row[x] & 0xff; g += (row[x] >> 8) & 0xff; b += (row[x] >> 16) & 0xff;
+					n++;
+				}
+			}
+			r /= n; g /= n; b /= n;
+			int u = (-43 * r - 85 * g + 128 * b + 32768 + 128) >> 8;
+			int v = (128 * r - 107 * g - 21 * b + 32768 + 128) >> 8;
+			u_plane[cy * chroma_width + cx] = (unsigned char)std::min(u, 255);
+			v_plane[cy * chroma_width + cx] = (unsigned char)std::min(v, 255);
+		}
+	}
+
+	fputs("FRAME\n", this->stream);
+	return fwrite(&this->planes[0], 1, this->planes.size(), this->stream) == this->planes.size();
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "Frame_buffer.h"
+
+/**
+* Writes a sequence of frames to disk on a background thread, either as
+* numbered PPM images or as one raw Y4M (YUV 4:2:0) video stream.
+*
+* The frames are copied into a small pool of buffers when they are queued,
+* so the caller can reuse its own buffer right away. When max_queued frames
+* are waiting, write() blocks until the thread has caught up, which bounds
+* the memory use when the disk is slower than the renderer.
+*/
+class Frame_writer
+{
+public:
+	enum Format { PPM_SEQUENCE, Y4M_STREAM };
+
+	// PPM frames are written to <output>0000.ppm, <output>0001.ppm, ..., a Y4M stream to <output>.y4m
+	Frame_writer(std::string const& output, Format format, int frame_rate, int max_queued);
+	// Waits until all queued frames are written
+	virtual ~Frame_writer();
+
+	void write(Frame_buffer const& frame);
+	// The rows are given bottom to top, as read by glReadPixels with GL_RGBA and GL_UNSIGNED_BYTE
+	void write(unsigned int const* pixels, int width, int height);
+
+	// Waits until all queued frames are written, returns false if any frame could not be written
+	bool finish();
+
+	int frames_written() const;
+private:
+	Frame_buffer* acquire(int width, int height);
+	void run();
+	bool write_frame(Frame_buffer const& frame, int index);
+	bool write_y4m(Frame_buffer const& frame);
+
+	std::string output;
+	Format format;
+	int frame_rate;
+	int max_queued;
+
+	FILE* stream;
+	int stream_width; int stream_height;
+	std::vector<unsigned char> planes;
+
+	std::deque<Frame_buffer*> queue;
+	std::vector<Frame_buffer*> free_buffers;
+	std::vector<Frame_buffer*> all_buffers;
+	int frames_done;
+	bool busy;
+	bool failed;
+	bool stopping;
+
+	mutable std::mutex lock;
+	std::condition_variable not_empty;
+	std::condition_variable not_full;
+	std::thread worker;
+};
+
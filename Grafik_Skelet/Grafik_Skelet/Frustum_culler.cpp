@@ -0,0 +1,193 @@
+#include "Frustum_culler.h"
+#include <algorithm>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define FRUSTUM_CULLER_AVX2
+#elif defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+	#include <emmintrin.h>
+	#define FRUSTUM_CULLER_SSE2
+#endif
+
+void Bounding_boxes::resize(size_t size)
+{
+	this->min_x.resize(size); this->min_y.resize(size); this->min_z.resize(size);
+	this->max_x.resize(size); this->max_y.resize(size); this->max_z.resize(size);
+}
+
+size_t Bounding_boxes::size() const
+{
+	return this->min_x.size();
+}
+
+void Bounding_boxes::set(size_t i, glm::vec3 const& min, glm::vec3 const& max)
+{
+	this->min_x[i] = min.x; this->min_y[i] = min.y; this->min_z[i] = min.z;
+	this->max_x[i] = max.x; this->max_y[i] = max.y; this->max_z[i] = max.z;
+}
+
+void Bounding_boxes::set(size_t i, glm::vec3 const* points, size_t count)
+{
+	glm::vec3 min = points[0];
+	glm::vec3 max = points[0];
+	for (size_t j = 1; j < count; j++) {
+		min = glm::min(min, points[j]);
+		max = glm::max(max, points[j]);
+	}
+	this->set(i, min, max);
+}
+
+void Bounding_spheres::resize(size_t size)
+{
+	this->x.resize(size); this->y.resize(size); this->z.resize(size);
+	this->radius.resize(size);
+}
+
+size_t Bounding_spheres::size() const
+{
+	return this->x.size();
+}
+
+void Bounding_spheres::set(size_t i, glm::vec3 const& center, float radius)
+{
+	this->x[i] = center.x; this->y[i] = center.y; this->z[i] = center.z;
+	this->radius[i] = radius;
+}
+
+Frustum_culler::Frustum_culler(void)
+{
+	// Nothing is culled until the planes are set
+	for (int i = 0; i < NUM_PLANES; i++) {
+		this->frustum[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+}
+
+Frustum_culler::~Frustum_culler(void)
+{
+}
+
+void Frustum_culler::planes(glm::vec4 const* planes)
+{
+	std::copy(planes, planes + NUM_PLANES, this->frustum);
+}
+
+bool Frustum_culler::visible(glm::vec3 const& min, glm::vec3 const& max) const
+{
+	for (int p = 0; p < NUM_PLANES; p++) {
+		glm::vec4 const& plane = this->frustum[p];
+		// The corner furthest along the normal is the last one to leave the plane
+		glm::vec3 corner(plane.x >= 0.0f ? max.x : min.x,
+						 plane.y >= 0.0f ? max.y : min.y,
+						 plane.z >= 0.0f ? max.z : min.z);
+		if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+bool Frustum_culler::visible(glm::vec3 const& center, float radius) const
+{
+	for (int p = 0; p < NUM_PLANES; p++) {
+		glm::vec4 const& plane = this->frustum[p];
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+	}
+	return true;
+}
+
+void Frustum_culler::cull(Bounding_boxes const& boxes, std::vector<unsigned int>& visible) const
+{
+	size_t count = boxes.size();
+	visible.assign((count + 31) / 32, 0);
+
+	size_t i = 0;
+#if defined(FRUSTUM_CULLER_AVX2) || defined(FRUSTUM_CULLER_SSE2)
+	// The corner of each box is picked per plane, since the sign of the normal is the same for all boxes
+	float const* corner_x[NUM_PLANES]; float const* corner_y[NUM_PLANES]; float const* corner_z[NUM_PLANES];
+	for (int p = 0; p < NUM_PLANES; p++) {
+		corner_x[p] = this->frustum[p].x >= 0.0f ? boxes.max_x.data() : boxes.min_x.data();
+		corner_y[p] = this->frustum[p].y >= 0.0f ? boxes.max_y.data() : boxes.min_y.data();
+		corner_z[p] = this->frustum[p].z >= 0.0f ? boxes.max_z.data() : boxes.min_z.data();
+	}
+#endif
+#if defined(FRUSTUM_CULLER_AVX2)
+	for (; i + 8 <= count; i += 8) {
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < NUM_PLANES; p++) {
+			__m256 d = _mm256_set1_ps(this->frustum[p].w);
+			d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(this->frustum[p].x), _mm256_loadu_ps(corner_x[p] + i)));
+			d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(this->frustum[p].y), _mm256_loadu_ps(corner_y[p] + i)));
+			d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(this->frustum[p].z), _mm256_loadu_ps(corner_z[p] + i)));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+		// i is a multiple of 8, so the 8 bits never straddle two words
+		visible[i / 32] |= (unsigned int)_mm256_movemask_ps(inside) << (i % 32);
+	}
+#elif defined(FRUSTUM_CULLER_SSE2)
+	for (; i + 4 <= count; i += 4) {
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < NUM_PLANES; p++) {
+			__m128 d = _mm_set1_ps(this->frustum[p].w);
+			d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(this->frustum[p].x), _mm_loadu_ps(corner_x[p] + i)));
+			d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(this->frustum[p].y), _mm_loadu_ps(corner_y[p] + i)));
+			d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(this->frustum[p].z), _mm_loadu_ps(corner_z[p] + i)));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(d, _mm_setzero_ps()));
+		}
+		// i is a multiple of 4, so the 4 bits never straddle two words
+		visible[i / 32] |= (unsigned int)_mm_movemask_ps(inside) << (i % 32);
+	}
+#endif
+	for (; i < count; i++) {
+		glm::vec3 min(boxes.min_x[i], boxes.min_y[i], boxes.min_z[i]);
+		glm::vec3 max(boxes.max_x[i], boxes.max_y[i], boxes.max_z[i]);
+		if (this->visible(min, max))
+			visible[i / 32] |= 1u << (i % 32);
+	}
+}
+
+void Frustum_culler::cull(Bounding_spheres const& spheres, std::vector<unsigned int>& visible) const
+{
+	size_t count = spheres.size();
+	visible.assign((count + 31) / 32, 0);
+
+	size_t i = 0;
+#if defined(FRUSTUM_CULLER_AVX2)
+	for (; i + 8 <= count; i += 8) {
+		__m256 x = _mm256_loadu_ps(&spheres.x[i]);
+		__m256 y = _mm256_loadu_ps(&spheres.y[i]);
+		__m256 z = _mm256_loadu_ps(&spheres.z[i]);
+		__m256 minus_radius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&spheres.radius[i]));
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < NUM_PLANES; p++) {
+			__m256 d = _mm256_set1_ps(this->frustum[p].w);
+			d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(this->frustum[p].x), x));
+			d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(this->frustum[p].y), y));
+			d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(this->frustum[p].z), z));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, minus_radius, _CMP_GE_OQ));
+		}
+		visible[i / 32] |= (unsigned int)_mm256_movemask_ps(inside) << (i % 32);
+	}
+#elif defined(FRUSTUM_CULLER_SSE2)
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_loadu_ps(&spheres.x[i]);
+		__m128 y = _mm_loadu_ps(&spheres.y[i]);
+		__m128 z = _mm_loadu_ps(&spheres.z[i]);
+		__m128 minus_radius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i]));
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < NUM_PLANES; p++) {
+			__m128 d = _mm_set1_ps(this->frustum[p].w);
+			d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(this->frustum[p].x), x));
+			d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(this->frustum[p].y), y));
+			d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(this->frustum[p].z), z));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(d, minus_radius));
+		}
+		visible[i / 32] |= (unsigned int)_mm_movemask_ps(inside) << (i % 32);
+	}
+#endif
+	for (; i < count; i++) {
+		if (this->visible(glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]))
+			visible[i / 32] |= 1u << (i % 32);
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+
+#include "glmutils.h"
+
+/**
+* Axis aligned bounding boxes in world coordinates, in structure-of-arrays layout.
+*/
+struct Bounding_boxes
+{
+	std::vector<float> min_x; std::vector<float> min_y; std::vector<float> min_z;
+	std::vector<float> max_x; std::vector<float> max_y; std::vector<float> max_z;
+
+	void resize(size_t size);
+	size_t size() const;
+	void set(size_t i, glm::vec3 const& min, glm::vec3 const& max);
+	// Sets box i to the bounds of the points
+	void set(size_t i, glm::vec3 const* points, size_t count);
+};
+
+/**
+* Bounding spheres in world coordinates, in structure-of-arrays layout.
+*/
+struct Bounding_spheres
+{
+	std::vector<float> x; std::vector<float> y; std::vector<float> z;
+	std::vector<float> radius;
+
+	void resize(size_t size);
+	size_t size() const;
+	void set(size_t i, glm::vec3 const& center, float radius);
+};
+
+/**
+* Tests bounding volumes against the planes of a view volume, e.g. the ClipPlanes() of a Camera.
+* The result is a bit mask with bit i % 32 of word i / 32 set when volume i may be visible.
+* The volumes are tested 8 at a time when compiled with AVX2, otherwise 4 at a time with SSE2.
+*
+* The test is conservative: a volume is only culled when it is entirely outside one
+* of the planes, so a few volumes near the corners are kept although they are invisible.
+*/
+class Frustum_culler
+{
+public:
+	Frustum_culler(void);
+	virtual ~Frustum_culler(void);
+
+	// Six planes with unit normals, a point p is inside when dot(plane, vec4(p, 1)) >= 0
+	void planes(glm::vec4 const* planes);
+
+	void cull(Bounding_boxes const& boxes, std::vector<unsigned int>& visible) const;
+	void cull(Bounding_spheres const& spheres, std::vector<unsigned int>& visible) const;
+
+	// Single volumes, for callers which do not have arrays
+	bool visible(glm::vec3 const& min, glm::vec3 const& max) const;
+	bool visible(glm::vec3 const& center, float radius) const;
+
+	static bool is_set(std::vector<unsigned int> const& mask, size_t i)
+	{
+		return (mask[i / 32] >> (i % 32) & 1) != 0;
+	}
+private:
+	static const int NUM_PLANES = 6;
+	glm::vec4 frustum[NUM_PLANES];
+};
+
@@ -0,0 +1,125 @@
+/** @file
+* A mesh which stays resident and is drawn many times with one instanced draw call.
+*/
+
+#include "InstancedMesh.h"
+
+#include <cstddef>
+
+#include "WeldedMesh.h"
+
+InstancedMesh::InstancedMesh(std::vector<glm::vec3> const& vertices, std::vector<glm::vec3> const& normals)
+{
+	std::vector<WeldedVertex> unique;
+	std::vector<GLuint> indices;
+	weldTriangles(vertices, normals, &unique, &indices);
+
+	m_vertexCount = (GLsizei)unique.size();
+	m_indexCount = (GLsizei)indices.size();
+	m_instanceCount = 0;
+	m_instanceCapacity = 0;
+
+	glGenVertexArrays(1, &m_vertexArray);
+	glGenBuffers(1, &m_vertexBuffer);
+	glGenBuffers(1, &m_indexBuffer);
+	glGenBuffers(1, &m_instanceBuffer);
+	glBindVertexArray(m_vertexArray);
+
+	// Positions and normals interleaved, at the locations of vertPosition and vertReflect
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, unique.size() * sizeof(WeldedVertex), unique.empty() ? NULL : &unique[0], GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(WeldedVertex), (void*)offsetof(WeldedVertex, position));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(WeldedVertex), (void*)offsetof(WeldedVertex, normal));
+	glEnableVertexAttribArray(1);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.empty() ? NULL : &indices[0], GL_STATIC_DRAW);
+
+	// instanceTransform and instanceNormalMatrix take one location per column,
+	// instanceMaterial is an integer attribute
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	for(int column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, sizeof(Instance),
+							  (void*)(offsetof(Instance, transform) + column * sizeof(glm::vec4)));
+		glEnableVertexAttribArray(2 + column);
+		glVertexAttribDivisor(2 + column, 1);
+	}
+	glVertexAttribIPointer(6, 1, GL_INT, sizeof(Instance), (void*)offsetof(Instance, material));
+	glEnableVertexAttribArray(6);
+	glVertexAttribDivisor(6, 1);
+	for(int column = 0; column < 3; column++)
+	{
+		glVertexAttribPointer(7 + column, 3, GL_FLOAT, GL_FALSE, sizeof(Instance),
+							  (void*)(offsetof(Instance, normalMatrix) + column * sizeof(glm::vec3)));
+		glEnableVertexAttribArray(7 + column);
+		glVertexAttribDivisor(7 + column, 1);
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+InstancedMesh::~InstancedMesh()
+{
+	glDeleteBuffers(1, &m_instanceBuffer);
+	glDeleteBuffers(1, &m_indexBuffer);
+	glDeleteBuffers(1, &m_vertexBuffer);
+	glDeleteVertexArrays(1, &m_vertexArray);
+}
+
+void InstancedMesh::setInstances(std::vector<glm::mat4x4> const& transforms, std::vector<int> const& materials)
+{
+	std::vector<Instance> instances(transforms.size());
+	for(size_t i = 0; i < instances.size(); i++)
+	{
+		instances[i].transform = transforms[i];
+		instances[i].normalMatrix = glm::transpose(glm::inverse(glm::mat3(transforms[i])));
+		instances[i].material = i < materials.size() ? materials[i] : 0;
+	}
+	m_instanceCount = (GLsizei)instances.size();
+	if(instances.empty())
+		return;
+
+	// The buffer is only reallocated when it grows, otherwise the contents are replaced
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	if(m_instanceCount > m_instanceCapacity)
+	{
+		glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(Instance), &instances[0], GL_STATIC_DRAW);
+		m_instanceCapacity = m_instanceCount;
+	}
+	else
+	{
+		glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(Instance), &instances[0]);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstancedMesh::draw() const
+{
+	if(m_instanceCount == 0 || m_indexCount == 0)
+		return;
+
+	glDrawElementsInstanced(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, 0, m_instanceCount);
+}
+
+GLuint InstancedMesh::vertexArray() const
+{
+	return m_vertexArray;
+}
+
+GLsizei InstancedMesh::vertexCount() const
+{
+	return m_vertexCount;
+}
+
+GLsizei InstancedMesh::indexCount() const
+{
+	return m_indexCount;
+}
+
+GLsizei InstancedMesh::instanceCount() const
+{
+	return m_instanceCount;
+}
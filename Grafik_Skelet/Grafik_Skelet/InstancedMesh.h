@@ -0,0 +1,75 @@
+/** @file
+* A mesh which stays resident and is drawn many times with one instanced draw call.
+*/
+
+#ifndef INSTANCED_MESH_H
+#define INSTANCED_MESH_H
+
+#if defined(WIN32) || defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#endif
+
+#if defined(__APPLE__) && defined(__MACH__)
+	#include <OpenGL/glew.h>
+	#include <OpenGL/gl.h>
+	#include <OpenGL/glu.h>
+#else
+	#include <GL/glew.h>
+	#include <GL/gl.h>
+	#include <GL/glu.h>
+#endif
+
+#include <vector>
+
+#include "glmutils.h"
+
+/**
+* The triangles are welded into an indexed mesh when it is created, and every
+* instance has a model matrix, its normal matrix and an index into the InstanceMaterials
+* block, which are read by the INSTANCED variant of Shader.vert as vertex attributes
+* 2 to 9 with a divisor of 1. draw() draws all the instances with glDrawElementsInstanced.
+*/
+class InstancedMesh
+{
+	public:
+		/** The triangles given as triples of vertices, with a normal per vertex */
+		InstancedMesh(std::vector<glm::vec3> const& vertices, std::vector<glm::vec3> const& normals);
+		~InstancedMesh();
+
+		/**
+		* Replaces the instances, transforms[i] and materials[i] are the model matrix
+		* and the material index of instance i.
+		*/
+		void setInstances(std::vector<glm::mat4x4> const& transforms, std::vector<int> const& materials);
+
+		/** Draws all the instances, with vertexArray() bound */
+		void draw() const;
+
+		GLuint vertexArray() const;
+
+		GLsizei vertexCount() const;
+		GLsizei indexCount() const;
+		GLsizei instanceCount() const;
+
+	private:
+		// The per instance attributes, interleaved
+		struct Instance
+		{
+			glm::mat4x4 transform;
+			glm::mat3x3 normalMatrix;
+			GLint material;
+		};
+
+		GLuint m_vertexArray;
+		GLuint m_vertexBuffer;
+		GLuint m_indexBuffer;
+		GLuint m_instanceBuffer;
+
+		GLsizei m_vertexCount;
+		GLsizei m_indexCount;
+		GLsizei m_instanceCount;
+		GLsizei m_instanceCapacity;
+};
+
+#endif
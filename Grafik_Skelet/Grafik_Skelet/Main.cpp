@@ -25,13 +25,29 @@
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
 using std::string;
 using std::ifstream;
 
 #include "ShaderProgram.h"
 #include "DotMaker.h"
 #include "Line_rasterizer.h"
+#include "Fast_line_rasterizer.h"
 #include "Edge_rasterizer.h"
+#include "Software_renderer.h"
+#include "Frame_writer.h"
+#include "PboReadback.h"
+#include "Frame_scheduler.h"
+#include "UniformBuffer.h"
+#include "SceneUniforms.h"
+#include "ShaderReloader.h"
+#include "Frustum_culler.h"
+#include "Multi_view_renderer.h"
+#include "Scene.h"
+#include "StreamBuffer.h"
+#include "WeldedMesh.h"
 #include <algorithm>
 #include "House.h"
 #include "glmutils.h"
@@ -45,14 +61,33 @@ struct point_xy {
 	int x,y;
 };
 
+// The variant of the lighting shaders, see the #defines in Shader.vert
+struct LightingVariant {
+	bool perVertex;
+	int numLights;
+	bool backFaceColoring;
+};
+
+static LightingVariant lightingVariant = { false, 1, true };
+
 /**
 * Use this function to define keyboard control of the window.
 * Find the SDL2 keycodes here:
 * https://wiki.libsdl.org/SDL_Keycode
+* Return true if the key changed the scene, so that it is drawn again.
 */
-static void controlScene(int key)
+static bool controlScene(int key)
 {
-	if(key == SDLK_1) {}
+	if(key == SDLK_1) {
+		// Switch between per fragment (Phong) and per vertex (Gouraud) shading
+		lightingVariant.perVertex = !lightingVariant.perVertex;
+		return true;
+	}
+	if(key == SDLK_2) {
+		lightingVariant.backFaceColoring = !lightingVariant.backFaceColoring;
+		return true;
+	}
+	return false;
 }
 
 // Checks which y-coordinate has the highest value (used for sorting the coordinates)
@@ -63,14 +98,9 @@ static bool greaterThan_y(point_xy p1, point_xy p2)
 
 static void drawLine(int x1, int y1, int x2, int y2)
 {
-	// Init new rasterizer with two given points
-	Line_rasterizer *rasterizer = new Line_rasterizer();
-	rasterizer->init(x1,y1, x2,y2);
-	// While there is more points (fragments) to draw, keep drawing them
-	while(rasterizer->more_fragments())
-	{
-		rasterizer->next_fragment();
-	}
+	// Draws the same fragments as Line_rasterizer, with the inner loop specialized for the octant
+	Dot_sink sink;
+	Fast_line_rasterizer::rasterize(x1,y1, x2,y2, sink);
 }
 
 static void drawTriangle(int x1, int y1, int x2, int y2, int x3, int y3)
@@ -114,8 +144,8 @@ static void drawTriangle(int x1, int y1, int x2, int y2, int x3, int y3)
 	while(rasterizerLeft->more_fragments() && rasterizerRight->more_fragments())
 	{
 		// Get current coordinates
-		int left_x = rasterizerLeft->x(); int left_y = rasterizerLeft->y();
-		int right_x = rasterizerRight->x();	int right_y = rasterizerRight->y();
+		int left_x = rasterizerLeft->x_unchecked(); int left_y = rasterizerLeft->y_unchecked();
+		int right_x = rasterizerRight->x_unchecked();
 
 		// Increment values used in upcoming loop
 		int cur_left_x = left_x;
@@ -215,6 +245,22 @@ glm::vec3 dini_n(float u, float v){
   return glm::cross(glm::vec3(x1,y1,z1), glm::vec3(x2,y2,z2));
 }
 
+// The samples of generalSampling() change with the parameters, so they are streamed instead of
+// being uploaded into new buffers every call. Both are created by the first call
+static GLuint samplingVertexArray = 0;
+static StreamBuffer* samplingStream = NULL;
+
+// Frees the buffers of generalSampling(), call it before the GL context is destroyed
+static void releaseSampling()
+{
+	if(samplingStream == NULL)
+		return;
+	delete samplingStream;
+	samplingStream = NULL;
+	glDeleteVertexArrays(1, &samplingVertexArray);
+	samplingVertexArray = 0;
+}
+
 // Visualization of a general surface using the Sampling algorithm 
 void generalSampling(
   glm::vec3 (*func[]  ) (float, float),  // Function(s) for position
@@ -262,27 +308,36 @@ void generalSampling(
 		}
 	}
 
+	if(vertices.empty())
+		return;
+
+	if(samplingStream == NULL)
+	{
+		// Enough for the four surfaces of the Klein Bottle at 50 by 50 samples, it grows for more
+		glGenVertexArrays(1, &samplingVertexArray);
+		samplingStream = new StreamBuffer(GL_ARRAY_BUFFER, 4 * 50 * 50 * 6 * 2 * sizeof(glm::vec3));
+	}
+	StreamBuffer* stream = samplingStream;
+
+	// The vertices followed by the normals
+	GLintptr offset = 0;
+	glm::vec3* samples = (glm::vec3*)stream->map(2 * vertices.size() * sizeof(glm::vec3), &offset);
+	std::copy(vertices.begin(), vertices.end(), samples);
+	std::copy(normals.begin(), normals.end(), samples + vertices.size());
+	stream->unmap();
+
 	// Now draw the object
-	// Genereate Vertex Array Object and buffers
-	GLuint vao[1], vbo[2];
-	glGenVertexArrays(1, vao);
-	glGenBuffers(2, vbo); 
-	// Bind the vertices (triangles)
-	glBindVertexArray(vao[0]);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * 3 * sizeof(GLfloat), &vertices[0], GL_STATIC_DRAW);	
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	glBindVertexArray(samplingVertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, stream->buffer());
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)offset);
 	glEnableVertexAttribArray(0);
-	// Bind the vertices (normals)
-	glBindVertexArray(vao[0]);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
-	glBufferData(GL_ARRAY_BUFFER, normals.size() * 3 * sizeof(GLfloat), &normals[0], GL_STATIC_DRAW);	
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)(offset + vertices.size() * sizeof(glm::vec3)));
 	glEnableVertexAttribArray(1);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	// Now draw the all vertices
-	glDrawArrays(GL_TRIANGLES, 0, normals.size());
-	glDisableVertexAttribArray(0);
-
+	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
+	glBindVertexArray(0);
+	stream->advance();
 }
 
 // Returns an array with all triangles and normals in the given Bezierpatch
@@ -322,12 +377,51 @@ static std::vector<std::vector<glm::vec3>> trianglesInPatch(std::vector<BezierPa
 	return patchPointsAndNormals;
 }
 
-// Visualization of bezier surfaces using the SubDivision algorithm 
-static void bezierSubDivision(int subdivisions, const char *filename)
+// Removes the patches which are outside the view volumes of all the cullers. A patch lies within
+// the convex hull of its control points, so it is invisible when the bounding box of those is
+static void cullPatches(std::vector<BezierPatch>* patches, std::vector<Frustum_culler> const& cullers)
+{
+	Bounding_boxes boxes;
+	boxes.resize(patches->size());
+	for (size_t n = 0; n < patches->size(); n++)
+	{
+		glm::vec3 points[16];
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				points[i * 4 + j] = (*patches)[n][i + 1][j + 1];
+		boxes.set(n, points, 16);
+	}
+
+	// The patches are kept when they are visible in any of the views
+	std::vector<unsigned int> visible, visibleInView;
+	cullers[0].cull(boxes, visible);
+	for (size_t view = 1; view < cullers.size(); view++)
+	{
+		cullers[view].cull(boxes, visibleInView);
+		for (size_t i = 0; i < visible.size(); i++)
+			visible[i] |= visibleInView[i];
+	}
+
+	size_t kept = 0;
+	for (size_t n = 0; n < patches->size(); n++)
+	{
+		if (Frustum_culler::is_set(visible, n))
+			(*patches)[kept++] = (*patches)[n];
+	}
+	patches->resize(kept);
+}
+
+// Generates the triangles and normals of the bezier surfaces using the SubDivision algorithm.
+// When cullers are given, the patches outside all their view volumes are dropped before every subdivision
+static void bezierGeometry(int subdivisions, const char *filename,
+						   std::vector<glm::vec3>* vertices, std::vector<glm::vec3>* normals,
+						   std::vector<Frustum_culler> const* cullers = NULL)
 {
 	std::vector<BezierPatch> bezierPatches;		
 	// Read data file containing the Bezierpatch(es)
 	ReadBezierPatches(filename, bezierPatches);
+	if (cullers != NULL && !cullers->empty())
+		cullPatches(&bezierPatches, *cullers);
 		
 	// Compute the offset for the DLB patch/matrix
 	glm::mat4x4 DLB(glm::vec4(8.0f, 0.0f, 0.0f, 0.0f),
@@ -363,53 +457,32 @@ static void bezierSubDivision(int subdivisions, const char *filename)
 		// Override the previous array which makes it possible to make further subdivisions if needed
 		bezierPatches = subPatches;
 		subPatches.clear();
+		if (cullers != NULL && !cullers->empty())
+			cullPatches(&bezierPatches, *cullers);
 		subdivisions--;
 	}
 	
 	std::vector<std::vector<glm::vec3>> patchPointsAndNormals;
-	std::vector<glm::vec3> Gtotal_controlpoints;
-	std::vector<glm::vec3> Gtotal_normalvectors;
 	// Collect triangles and normals from all patches and put them in the same array
 	patchPointsAndNormals = trianglesInPatch(bezierPatches);
 	// Splitting the normals triangles in two arrays
-	Gtotal_controlpoints = patchPointsAndNormals[0];
-	Gtotal_normalvectors = patchPointsAndNormals[1];
-	
-	// Now draw the object
-	// Genereate Vertex Array Object and buffers
-	GLuint vao[1], vbo[2];
-	glGenVertexArrays(1, vao);
-	glGenBuffers(2, vbo); 
-	// Bind the vertices (triangles)
-	glBindVertexArray(vao[0]);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
-	glBufferData(GL_ARRAY_BUFFER, Gtotal_controlpoints.size() * 3 * sizeof(GLfloat), &Gtotal_controlpoints[0], GL_STATIC_DRAW);	
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-	glEnableVertexAttribArray(0);
-	// Bind the vertices (normals)
-	glBindVertexArray(vao[0]);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
-	glBufferData(GL_ARRAY_BUFFER, Gtotal_normalvectors.size() * 3 * sizeof(GLfloat), &Gtotal_normalvectors[0], GL_STATIC_DRAW);	
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-	glEnableVertexAttribArray(1);
-	// Now draw the all vertices
-	glDrawArrays(GL_TRIANGLES, 0, Gtotal_normalvectors.size());
-	glDisableVertexAttribArray(0);
-
+	*vertices = patchPointsAndNormals[0];
+	*normals = patchPointsAndNormals[1];
 }
 
-static void drawScene(GLuint shaderID)
-{
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-	glEnable(GL_DEPTH_TEST);
-	glClearDepth(-1.0f);
-	glDepthFunc(GL_GREATER);
-
-	glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+// Material and light of the scene, the same for the OpenGL and the software renderer
+struct SceneMaterial {
+	glm::vec3 ambient, diffuse, specular;
+	float shiny;
+};
 
-	glUseProgram(shaderID);
+struct SceneLight {
+	glm::vec4 position;
+	glm::vec3 intensity, ambient, diffuse, specular;
+};
 
+static Camera sceneCamera(int width, int height)
+{
 	// Camera parameters
 	/*glm::vec3 vrp(5.0f, 0.0f, 5.0f); // front view
 	glm::vec3 vpn(cosf((30.0f*M_PI)/180.0f), 0.0f, sinf((30.0f*M_PI)/180.0f)); // front view */
@@ -426,80 +499,131 @@ static void drawScene(GLuint shaderID)
 	float front_plane = 5.0f;
 	float back_plane = -10.0f; 
 
-	// Init the camera with the defined values
-	Camera *camera = new Camera(vrp, vpn, vup, prp, lower_left, upper_right, front_plane, back_plane, 800, 600);
-
-    // Set the shader matrixes 
-    GLuint dir;
-    dir = glGetUniformLocation(shaderID, "uModelMatrix");
-    if (dir >= 0){
-      glUniformMatrix4fv(dir, 1, GL_FALSE, &camera->ViewOrientation()[0][0]);
-    }	
-	glm::mat3 normalvectorMatrix = glm::inverseTranspose(glm::mat3(camera->ViewOrientation()));
-    dir = glGetUniformLocation(shaderID, "normalvectorMatrix");
-    if (dir >= 0){
-      glUniformMatrix3fv(dir, 1, GL_FALSE, &normalvectorMatrix[0][0]);
-    }
-    glm::mat4 projectionMatrix = camera->ViewProjection();
-    dir = glGetUniformLocation(shaderID, "projectionMatrix");
-    if (dir >= 0){
-      glUniformMatrix4fv(dir, 1, GL_FALSE, &projectionMatrix[0][0]);
-    }
-	
+	return Camera(vrp, vpn, vup, prp, lower_left, upper_right, front_plane, back_plane, width, height);
+}
+
+// The camera of sceneCamera() spun around the z axis, count views evenly spaced
+static std::vector<Camera> sceneCameras(int count, int width, int height)
+{
+	std::vector<Camera> cameras;
+	Camera camera = sceneCamera(width, height);
+	for (int i = 0; i < count; i++)
+	{
+		glm::mat4 spin = glm::rotate(2.0f * float(M_PI) * i / count, glm::vec3(0.0f, 0.0f, 1.0f));
+		Camera view = camera;
+		view.VRP(glm::vec3(spin * glm::vec4(camera.VRP(), 1.0f)));
+		view.VPN(glm::vec3(spin * glm::vec4(camera.VPN(), 0.0f)));
+		cameras.push_back(view);
+	}
+	return cameras;
+}
+
+static SceneMaterial sceneMaterial()
+{
 	// Material components
-	glm::vec3 matAmbient = glm::vec3(0.0f, 0.75f, 1.0f) * 0.5f;
-	glm::vec3 matDiffuse = glm::vec3(0.0f, 0.75f, 1.0f) * 0.75f;
-	glm::vec3 matSpecular = glm::vec3(1.0f, 1.0f, 1.0f) * 0.9f;
-	float matShiny = 20.0f;
+	SceneMaterial material;
+	material.ambient = glm::vec3(0.0f, 0.75f, 1.0f) * 0.5f;
+	material.diffuse = glm::vec3(0.0f, 0.75f, 1.0f) * 0.75f;
+	material.specular = glm::vec3(1.0f, 1.0f, 1.0f) * 0.9f;
+	material.shiny = 20.0f;
+	return material;
+}
+
+static SceneLight sceneLight()
+{
 	// light components
-	//glm::vec4 lightPos = glm::vec4(266.395325f, 274.291267f, -43.696048f, 1.0f);
-	glm::vec4 lightPos = glm::vec4(250.0f, 300.0f, -20.0f, 1.0f);
-	//glm::vec4 lightPos = glm::vec4(0.0f, 0.0f, 80.0f, 1.0f); // top light
-	glm::vec3 lightIntensity = glm::vec3(1.0f, 1.0f, 1.0f);
-	glm::vec3 lightAmbient = glm::vec3(0.5f, 0.5f, 0.5f);
-	glm::vec3 lightDiffuse = glm::vec3(1.0f, 1.0f, 1.0f);
-	glm::vec3 lightSpecular = glm::vec3(1.0f, 1.0f, 1.0f);
-
-	// Send values to shader-program
-	dir = glGetUniformLocation(shaderID, "matAmbient");
-	if (dir >= 0){
-		glUniform3fv(dir, 1, (float*)&matAmbient);
-	}
-	dir = glGetUniformLocation(shaderID, "matDiffuse");
-	if (dir >= 0){
-		glUniform3fv(dir, 1, (float*)&matDiffuse);
-	}
-	dir = glGetUniformLocation(shaderID, "matSpecular");
-	if (dir >= 0){
-		glUniform3fv(dir, 1, (float*)&matSpecular);
-	}
-	dir = glGetUniformLocation(shaderID, "lightIntensity");
-	if (dir >= 0){
-		glUniform3fv(dir, 1, (float*)&lightIntensity);
+	SceneLight light;
+	//light.position = glm::vec4(266.395325f, 274.291267f, -43.696048f, 1.0f);
+	light.position = glm::vec4(250.0f, 300.0f, -20.0f, 1.0f);
+	//light.position = glm::vec4(0.0f, 0.0f, 80.0f, 1.0f); // top light
+	light.intensity = glm::vec3(1.0f, 1.0f, 1.0f);
+	light.ambient = glm::vec3(0.5f, 0.5f, 0.5f);
+	light.diffuse = glm::vec3(1.0f, 1.0f, 1.0f);
+	light.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+	return light;
+}
+
+// Creates the meshes, materials, nodes and lights of the scene, they are kept until the window is closed.
+// With instances > 0 the teapot is drawn as a field of that many instances instead of a single node.
+// The first numLights lights of the Light block are copies of sceneLight() spread around the teapot
+static void buildScene(Scene* scene, int instances, int numLights)
+{
+	SceneMaterial material = sceneMaterial();
+	MaterialBlock materialBlock;
+	materialBlock.ambient = material.ambient;
+	materialBlock.diffuse = material.diffuse;
+	materialBlock.specular = material.specular;
+	materialBlock.shiny = material.shiny;
+	int teapotMaterial = scene->addMaterial(materialBlock);
+
+	SceneLight light = sceneLight();
+	LightBlock lightBlock;
+	for(int i = 0; i < numLights; i++)
+	{
+		// Every light adds its ambient term in the shaders, so they share the ambient light of one
+		glm::mat4 around = glm::rotate(2.0f * float(M_PI) * i / numLights, glm::vec3(0.0f, 0.0f, 1.0f));
+		lightBlock.lights[i].position = around * light.position;
+		lightBlock.lights[i].intensity = light.intensity;
+		lightBlock.lights[i].ambient = light.ambient / float(numLights);
+		lightBlock.lights[i].diffuse = light.diffuse;
+		lightBlock.lights[i].specular = light.specular;
 	}
-	dir = glGetUniformLocation(shaderID, "lightAmbient");
-	if (dir >= 0){
-		glUniform3fv(dir, 1, (float*)&lightAmbient);
+	scene->setLights(lightBlock);
+
+	// The teapot is tessellated with the SubDivision algorithm and uploaded once,
+	// the scene culls it as a whole when it is outside the view volume
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec3> normals;
+	bezierGeometry(4, "./teapot.data", &vertices, &normals);
+	if(instances == 0)
+	{
+		int teapot = scene->addMesh(vertices, normals);
+		scene->addNode(teapot, teapotMaterial, glm::mat4(1.0f));
+		return;
 	}
-	dir = glGetUniformLocation(shaderID, "lightDiffuse");
-	if (dir >= 0){
-		glUniform3fv(dir, 1, (float*)&lightDiffuse);
+
+	// The same material in a few colors, the instances take turns
+	glm::vec3 colors[4] = { glm::vec3(0.0f, 0.75f, 1.0f), glm::vec3(1.0f, 0.5f, 0.0f),
+							glm::vec3(0.4f, 1.0f, 0.2f), glm::vec3(1.0f, 0.2f, 0.6f) };
+	int colorMaterials[4];
+	for(int i = 0; i < 4; i++)
+	{
+		MaterialBlock colored = materialBlock;
+		colored.ambient = colors[i] * 0.5f;
+		colored.diffuse = colors[i] * 0.75f;
+		colorMaterials[i] = scene->addMaterial(colored);
 	}
-	dir = glGetUniformLocation(shaderID, "lightSpecular");
-	if (dir >= 0){
-		glUniform3fv(dir, 1, (float*)&lightSpecular);
-	}	
-	dir = glGetUniformLocation(shaderID, "lightPos");
-	if (dir >= 0){
-		glUniform4fv(dir, 1, (float*)&lightPos);
-	}	
-	dir = glGetUniformLocation(shaderID, "matShiny");
-	if (dir >= 0){
-		glUniform1f(dir, matShiny);
+
+	// A square grid of teapots, scaled so the whole field fits in the window of the camera
+	int side = (int)std::ceil(std::sqrt((float)instances));
+	float spacing = 12.0f / side;
+	float scale = std::min(1.0f, spacing / 7.0f);
+	std::vector<glm::mat4> transforms;
+	std::vector<int> materials;
+	for(int i = 0; i < instances; i++)
+	{
+		glm::vec3 position((i % side + 0.5f) * spacing - 6.0f, (i / side + 0.5f) * spacing - 6.0f, 0.0f);
+		transforms.push_back(glm::translate(position) * glm::scale(glm::vec3(scale)));
+		materials.push_back(colorMaterials[i % 4]);
 	}
+	int field = scene->addInstancedMesh(vertices, normals);
+	scene->setInstances(field, transforms, materials);
+}
+
+static void drawScene(Scene* scene, GLuint shaderID, GLuint instancedShaderID, Camera const& camera)
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	// Draw the specified object using the SubDivision algorithm
-	bezierSubDivision(4, "./teapot.data");
+	glEnable(GL_DEPTH_TEST);
+	glClearDepth(-1.0f);
+	glDepthFunc(GL_GREATER);
+
+	glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+
+	// Only the nodes, materials and lights which changed are sent to OpenGL again,
+	// nothing is drawn while the shaders do not compile
+	if(shaderID != 0)
+		scene->draw(camera, shaderID, instancedShaderID);
 
 	// Sampling algorithm data for The Klein Bottle
 	glm::vec3 (*klein_f[4]) (float u, float v);
@@ -526,16 +650,194 @@ static void drawScene(GLuint shaderID)
 	glFlush();
 }
 
-static int fileRead(std::string const& filename, std::string* result)
+// Command-line options
+struct Options {
+	bool headless;      // --headless: render with the software renderer, without a window
+	int width, height;  // --width <pixels> --height <pixels>
+	int frames;         // --frames <count>: number of frames rendered in headless mode
+	int views;          // --views <count>: headless frames show the scene from count cameras side by side
+	std::string output; // --output <prefix>: frames are written to <prefix>0000.ppm, <prefix>0001.ppm, ...
+	Frame_writer::Format format; // --format ppm|y4m: y4m writes one video stream to <prefix>.y4m
+	bool record;        // --record: write the frames shown in the window too
+	int animationRate;  // --animate <fps>: redraw the window at a fixed rate instead of only on changes
+	bool vsync;         // --no-vsync: do not wait for the vertical retrace when swapping
+	std::string shaderCache; // --shader-cache <directory>: where linked programs are cached, "" disables it
+	LightingVariant lighting; // --lighting vertex|fragment --lights <count> --no-backface-color
+	bool hotReload;     // --no-hot-reload: do not watch the shader files for changes
+	int instances;      // --instances <count>: draw a field of teapots with one instanced draw call
+};
+
+static bool parseOptions(int argc, char *argv[], Options* options)
 {
-	std::ifstream ifs(filename.data());
-	if(ifs.is_open()) {
-		*result = std::string((std::istreambuf_iterator<char>(ifs)),
-							  (std::istreambuf_iterator<char>()));
-		ifs.close();
-		return 0;
+	options->headless = false;
+	options->width = 800;
+	options->height = 600;
+	options->frames = 1;
+	options->views = 1;
+	options->output = "frame";
+	options->format = Frame_writer::PPM_SEQUENCE;
+	options->record = false;
+	options->animationRate = 0;
+	options->vsync = true;
+	options->shaderCache = ".";
+	options->lighting = lightingVariant;
+	options->hotReload = true;
+	options->instances = 0;
+
+	for(int i = 1; i < argc; i++)
+	{
+		bool hasValue = (i + 1 < argc);
+		if(strcmp(argv[i], "--headless") == 0) {
+			options->headless = true;
+		}
+		else if(strcmp(argv[i], "--width") == 0 && hasValue) {
+			options->width = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--height") == 0 && hasValue) {
+			options->height = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--frames") == 0 && hasValue) {
+			options->frames = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--views") == 0 && hasValue) {
+			options->views = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--output") == 0 && hasValue) {
+			options->output = argv[++i];
+		}
+		else if(strcmp(argv[i], "--format") == 0 && hasValue) {
+			std::string format = argv[++i];
+			if(format == "ppm")
+				options->format = Frame_writer::PPM_SEQUENCE;
+			else if(format == "y4m")
+				options->format = Frame_writer::Y4M_STREAM;
+			else
+				return false;
+		}
+		else if(strcmp(argv[i], "--record") == 0) {
+			options->record = true;
+		}
+		else if(strcmp(argv[i], "--animate") == 0 && hasValue) {
+			options->animationRate = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--no-vsync") == 0) {
+			options->vsync = false;
+		}
+		else if(strcmp(argv[i], "--shader-cache") == 0 && hasValue) {
+			options->shaderCache = argv[++i];
+		}
+		else if(strcmp(argv[i], "--lighting") == 0 && hasValue) {
+			std::string lighting = argv[++i];
+			if(lighting == "vertex")
+				options->lighting.perVertex = true;
+			else if(lighting == "fragment")
+				options->lighting.perVertex = false;
+			else
+				return false;
+		}
+		else if(strcmp(argv[i], "--lights") == 0 && hasValue) {
+			options->lighting.numLights = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--no-backface-color") == 0) {
+			options->lighting.backFaceColoring = false;
+		}
+		else if(strcmp(argv[i], "--instances") == 0 && hasValue) {
+			options->instances = atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--no-hot-reload") == 0) {
+			options->hotReload = false;
+		}
+		else {
+			return false;
+		}
 	}
-	return -1;
+	return options->width > 0 && options->height > 0 && options->frames >= 0 && options->views >= 1 && options->instances >= 0 &&
+		   options->animationRate >= 0 &&
+		   options->lighting.numLights >= 1 && options->lighting.numLights <= MAX_LIGHTS;
+}
+
+// Renders the scene of drawScene() with the software renderer and writes the frames to disk.
+// With several views every frame is an atlas of the views, which share the culled and tessellated geometry
+static int renderHeadless(Options const& options)
+{
+	std::vector<Camera> cameras = sceneCameras(options.views, options.width, options.height);
+
+	// The cameras do not move, so the invisible patches are culled once
+	std::vector<Frustum_culler> cullers(cameras.size());
+	for(size_t i = 0; i < cameras.size(); i++)
+	{
+		cullers[i].planes(cameras[i].ClipPlanes());
+	}
+
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec3> normals;
+	bezierGeometry(4, "./teapot.data", &vertices, &normals, &cullers);
+
+	// Welded like the meshes of the scene, so the corners shared by the triangles
+	// are only transformed once through the post-transform cache
+	std::vector<WeldedVertex> unique;
+	std::vector<unsigned int> indices;
+	weldTriangles(vertices, normals, &unique, &indices);
+
+	Vertex_arrays mesh;
+	mesh.resize(unique.size());
+	for(size_t i = 0; i < unique.size(); i++)
+	{
+		mesh.set(i, unique[i].position, unique[i].normal);
+	}
+
+	SceneMaterial material = sceneMaterial();
+	SceneLight light = sceneLight();
+
+	Multi_view_renderer renderer(options.width, options.height);
+	renderer.material(material.ambient, material.diffuse, material.specular, material.shiny);
+	renderer.light(light.position, light.ambient, light.diffuse, light.specular);
+	renderer.views(cameras);
+
+	// The frames are encoded and written on another thread while the next one is rendered
+	Frame_writer writer(options.output, options.format, 30, 4);
+
+	Uint32 start = SDL_GetTicks();
+	for(int frame = 0; frame < options.frames; frame++)
+	{
+		renderer.clear(glm::vec4(0.2f, 0.2f, 0.2f, 1.0f));
+		renderer.draw_indexed_triangles(mesh, indices);
+
+		writer.write(renderer.atlas());
+	}
+	bool written = writer.finish();
+	Uint32 elapsed = SDL_GetTicks() - start;
+
+	if(!written) {
+		std::cerr << "Could not write the frames to " << options.output << std::endl;
+		return -6;
+	}
+
+	std::cout << options.frames << " frames in " << elapsed << " ms" << std::endl;
+	return 0;
+}
+
+// Returns the #defines which select a variant of the lighting shaders, instanced
+// variants read the model matrix and the material of every instance from vertex attributes
+static std::vector<std::string> lightingDefines(LightingVariant const& variant, bool instanced = false)
+{
+	std::vector<std::string> defines;
+	std::ostringstream maxLights, numLights;
+	maxLights << "MAX_LIGHTS " << MAX_LIGHTS;
+	numLights << "NUM_LIGHTS " << variant.numLights;
+	defines.push_back(maxLights.str());
+	defines.push_back(numLights.str());
+	if(variant.perVertex)
+		defines.push_back("LIGHTING_PER_VERTEX");
+	if(variant.backFaceColoring)
+		defines.push_back("BACK_FACE_COLORING");
+	if(instanced) {
+		std::ostringstream maxMaterials;
+		maxMaterials << "MAX_INSTANCE_MATERIALS " << MAX_INSTANCE_MATERIALS;
+		defines.push_back("INSTANCED");
+		defines.push_back(maxMaterials.str());
+	}
+	return defines;
 }
 
 /**
@@ -544,12 +846,31 @@ static int fileRead(std::string const& filename, std::string* result)
 */
 int main(int argc, char *argv[])
 {
+	Options options;
+	if(!parseOptions(argc, argv, &options)) {
+		std::cerr << "Usage: " << argv[0] << " [--headless] [--width <pixels>] [--height <pixels>]"
+				  << " [--frames <count>] [--views <count>] [--output <prefix>] [--format ppm|y4m] [--record]"
+				  << " [--animate <fps>] [--no-vsync] [--shader-cache <directory>]"
+				  << " [--lighting vertex|fragment] [--lights <count>] [--no-backface-color]"
+				  << " [--no-hot-reload] [--instances <count>]" << std::endl;
+		return -7;
+	}
+
+	// The timer works without a video device, so no window or context is created in headless mode
+	if(options.headless) {
+		if(SDL_Init(SDL_INIT_TIMER) < 0)
+			return -1;
+		int result = renderHeadless(options);
+		SDL_Quit();
+		return result;
+	}
+
 	//glewExperimental = true;
 	if(SDL_Init(SDL_INIT_VIDEO) < 0)
 		return -1;
 	
-	GLint width = 800;
-	GLint height = 600;
+	GLint width = options.width;
+	GLint height = options.height;
 	
 	SDL_Window* window = SDL_CreateWindow(
 		"Grafik 2015 framework",
@@ -576,30 +897,70 @@ int main(int argc, char *argv[])
 		return -4;
 	}
 
-	std::string vs = "";
-	std::string fs = "";
+	// The shaders are compiled in the background, and reloaded when the files are changed
+	ShaderReloader* shaders = new ShaderReloader("Shader.vert", "Shader.frag");
 
-	if(fileRead("Shader.vert", &vs) < 0 ||
-	   fileRead("Shader.frag", &fs) < 0)
+	if(!shaders->sourcesLoaded())
 	{
+		delete shaders;
 		SDL_GL_DeleteContext(glContext);
 		SDL_DestroyWindow(window);
 		SDL_Quit();
 		return -5;
 	}
 
-	GLuint shaderID = ShaderProgram::compileShaderProgram(vs, fs);
+	// Linked programs are loaded from the cache when the shaders and the driver have not changed
+	ShaderProgram::setBinaryCacheDirectory(options.shaderCache);
+
+	// The material and light blocks of every program are fed from the buffers of the scene
+	ShaderProgram::setUniformBlockBinding("Material", MATERIAL_BLOCK_BINDING);
+	ShaderProgram::setUniformBlockBinding("Light", LIGHT_BLOCK_BINDING);
+	ShaderProgram::setUniformBlockBinding("InstanceMaterials", INSTANCE_MATERIAL_BLOCK_BINDING);
+	Scene* scene = new Scene();
+	buildScene(scene, options.instances, options.lighting.numLights);
+
+	lightingVariant = options.lighting;
+	GLuint shaderID = shaders->program(lightingDefines(lightingVariant), "lighting");
+	GLuint instancedShaderID = 0;
+	if(shaderID == 0)
+		std::cerr << "The shaders did not compile, see error.txt" << std::endl;
 
 	// Create a Vertex Array Object
 	GLuint vertexArrayID = 0;
 	glGenVertexArrays(1, &vertexArrayID);
 	glBindVertexArray(vertexArrayID);
 
+	// Frames are read back through a ring of pixel buffers, so recording does not stall the GPU
+	Frame_writer* writer = NULL;
+	PboReadback* readback = NULL;
+	if(options.record) {
+		writer = new Frame_writer(options.output, options.format, 60, 4);
+		readback = new PboReadback(3);
+	}
+
+	// Adaptive vsync (-1) tears instead of halving the frame rate when a frame is late
+	if(options.vsync) {
+		if(SDL_GL_SetSwapInterval(-1) < 0)
+			SDL_GL_SetSwapInterval(1);
+	}
+	else {
+		SDL_GL_SetSwapInterval(0);
+	}
+
+	// The camera lives as long as the window, so its matrices are not computed again every frame
+	Camera camera = sceneCamera(width, height);
+
+	// Only draw when something changed, or at the animation rate
+	Frame_scheduler scheduler;
+	scheduler.animation_rate(options.animationRate);
+
 	GLint done = 0;
 	while(!done)
 	{
 		SDL_Event event;
-		while(SDL_PollEvent(&event))
+		// Sleeps until an event arrives or a frame is due, then handles all pending events
+		bool hasEvent = scheduler.wait_event(&event);
+		while(hasEvent)
 		{
 			if(event.type == SDL_QUIT) {
 				done = 1;
@@ -611,16 +972,51 @@ int main(int argc, char *argv[])
 					event.type = SDL_QUIT;
 					SDL_PushEvent((SDL_Event*)&event);
 				}
-				else {
-					controlScene(event.key.keysym.sym);
+				else if(controlScene(event.key.keysym.sym)) {
+					scheduler.invalidate();
 				}
 			}
+			hasEvent = scheduler.poll_event(&event);
+		}
+
+		// Redraw when a shader has been reloaded or a variant has linked, and check often while one is compiling
+		if(shaders->update(options.hotReload)) {
+			scheduler.invalidate();
 		}
+		scheduler.poll_interval(shaders->compiling() ? 10 : (options.hotReload ? 250 : 0));
+
+		if(!done && scheduler.frame_due())
+		{
+			// A new variant is compiled in the background. The lighting variants have the same
+			// attributes and uniforms, so the reloader hands out the last one of the family until
+			// the new one has linked. The programs are asked for every frame, since a reload
+			// deletes the programs it replaces
+			shaderID = shaders->program(lightingDefines(lightingVariant), "lighting");
+
+			// The nodes of the scene are only batched, and the instances drawn, with a program
+			// of an INSTANCED variant, which is all the "instanced" family holds; until one has
+			// linked the nodes are drawn one by one with shaderID
+			instancedShaderID = shaders->program(lightingDefines(lightingVariant, true), "instanced");
+			drawScene(scene, shaderID, instancedShaderID, camera);
+			if(readback != NULL) {
+				readback->readFrame(width, height, writer);
+			}
+			SDL_GL_SwapWindow(window);
+			scheduler.frame_drawn();
+		}
+	}
 
-		drawScene(shaderID);
-		SDL_GL_SwapWindow(window);
+	if(readback != NULL) {
+		readback->flush(writer);
+		delete readback;
+		delete writer;
 	}
 
+	delete scene;
+	delete shaders;
+	// The GL objects of the function-local helpers are freed while the context exists
+	DotMaker::release();
+	releaseSampling();
 	ShaderProgram::deleteShaderPrograms();
 	
 	SDL_GL_DeleteContext(glContext);
@@ -0,0 +1,246 @@
+/** @file
+* All resident meshes suballocated in one vertex and index buffer, drawn with multi draw indirect.
+*/
+
+#include "MeshBuffer.h"
+
+#include <algorithm>
+#include <cstddef>
+
+MeshBuffer::MeshBuffer()
+{
+	m_meshesDirty = false;
+	m_multiDrawIndirect = GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect;
+	m_baseInstance = GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+
+	// Written every frame, so they are streamed instead of specified again
+	m_drawStream = new StreamBuffer(GL_ARRAY_BUFFER, 1024 * sizeof(Draw));
+	m_commandStream = NULL;
+	if(m_multiDrawIndirect)
+		m_commandStream = new StreamBuffer(GL_DRAW_INDIRECT_BUFFER, 1024 * sizeof(DrawElementsIndirectCommand));
+
+	glGenVertexArrays(1, &m_vertexArray);
+	glGenBuffers(1, &m_vertexBuffer);
+	glGenBuffers(1, &m_indexBuffer);
+	glBindVertexArray(m_vertexArray);
+
+	// Positions and normals interleaved, at the locations of vertPosition and vertReflect
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(WeldedVertex), (void*)offsetof(WeldedVertex, position));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(WeldedVertex), (void*)offsetof(WeldedVertex, normal));
+	glEnableVertexAttribArray(1);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+
+	// The per draw attributes of the INSTANCED variant of Shader.vert, only enabled and pointed
+	// at the draws of the frame inside drawAll(), so the single mesh glDrawElementsBaseVertex
+	// items which RenderQueue issues with vertexArray() do not read them
+	for(GLuint location = 2; location <= 9; location++)
+		glVertexAttribDivisor(location, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+MeshBuffer::~MeshBuffer()
+{
+	delete m_commandStream;
+	delete m_drawStream;
+	glDeleteBuffers(1, &m_indexBuffer);
+	glDeleteBuffers(1, &m_vertexBuffer);
+	glDeleteVertexArrays(1, &m_vertexArray);
+}
+
+int MeshBuffer::addMesh(std::vector<glm::vec3> const& vertices, std::vector<glm::vec3> const& normals)
+{
+	std::vector<WeldedVertex> unique;
+	std::vector<GLuint> indices;
+	weldTriangles(vertices, normals, &unique, &indices);
+
+	// The indices stay relative to the mesh, the base vertex offsets them into the shared buffer
+	Mesh mesh;
+	mesh.firstIndex = (GLuint)m_indices.size();
+	mesh.indexCount = (GLsizei)indices.size();
+	mesh.baseVertex = (GLint)m_vertices.size();
+	mesh.boundsMin = glm::vec3(0.0f);
+	mesh.boundsMax = glm::vec3(0.0f);
+	if(!unique.empty())
+	{
+		mesh.boundsMin = unique[0].position;
+		mesh.boundsMax = unique[0].position;
+		for(size_t i = 1; i < unique.size(); i++)
+		{
+			mesh.boundsMin = glm::min(mesh.boundsMin, unique[i].position);
+			mesh.boundsMax = glm::max(mesh.boundsMax, unique[i].position);
+		}
+	}
+
+	m_vertices.insert(m_vertices.end(), unique.begin(), unique.end());
+	m_indices.insert(m_indices.end(), indices.begin(), indices.end());
+	m_meshesDirty = true;
+
+	m_meshes.push_back(mesh);
+	return (int)m_meshes.size() - 1;
+}
+
+GLsizei MeshBuffer::indexCount(int mesh) const
+{
+	return m_meshes[mesh].indexCount;
+}
+
+glm::vec3 const& MeshBuffer::boundsMin(int mesh) const
+{
+	return m_meshes[mesh].boundsMin;
+}
+
+glm::vec3 const& MeshBuffer::boundsMax(int mesh) const
+{
+	return m_meshes[mesh].boundsMax;
+}
+
+GLuint MeshBuffer::firstIndex(int mesh) const
+{
+	return m_meshes[mesh].firstIndex;
+}
+
+GLint MeshBuffer::baseVertex(int mesh) const
+{
+	return m_meshes[mesh].baseVertex;
+}
+
+GLuint MeshBuffer::vertexArray() const
+{
+	return m_vertexArray;
+}
+
+void MeshBuffer::upload()
+{
+	if(!m_meshesDirty)
+		return;
+
+	// Meshes are added while the scene is built, so the buffers are reallocated whole
+	glBindVertexArray(m_vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(WeldedVertex), m_vertices.empty() ? NULL : &m_vertices[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(GLuint), m_indices.empty() ? NULL : &m_indices[0], GL_STATIC_DRAW);
+	glBindVertexArray(0);
+	m_meshesDirty = false;
+}
+
+void MeshBuffer::clearDraws()
+{
+	m_commands.clear();
+	m_draws.clear();
+}
+
+void MeshBuffer::addDraw(int mesh, glm::mat4x4 const& transform, int material)
+{
+	Mesh const& drawn = m_meshes[mesh];
+	if(drawn.indexCount == 0)
+		return;
+
+	DrawElementsIndirectCommand command;
+	command.count = (GLuint)drawn.indexCount;
+	command.instanceCount = 1;
+	command.firstIndex = drawn.firstIndex;
+	command.baseVertex = drawn.baseVertex;
+	command.baseInstance = (GLuint)m_draws.size();
+	m_commands.push_back(command);
+
+	Draw draw;
+	draw.transform = transform;
+	draw.normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+	draw.material = material;
+	m_draws.push_back(draw);
+}
+
+GLsizei MeshBuffer::drawCount() const
+{
+	return (GLsizei)m_commands.size();
+}
+
+void MeshBuffer::drawAll()
+{
+	if(m_commands.empty())
+		return;
+
+	GLintptr drawOffset = 0;
+	Draw* draws = (Draw*)m_drawStream->map(m_draws.size() * sizeof(Draw), &drawOffset);
+	std::copy(m_draws.begin(), m_draws.end(), draws);
+	m_drawStream->unmap();
+	drawAttributes(drawOffset);
+	enableDrawAttributes(true);
+
+	if(m_multiDrawIndirect)
+	{
+		GLintptr commandOffset = 0;
+		DrawElementsIndirectCommand* commands = (DrawElementsIndirectCommand*)m_commandStream->map(
+			m_commands.size() * sizeof(DrawElementsIndirectCommand), &commandOffset);
+		std::copy(m_commands.begin(), m_commands.end(), commands);
+		m_commandStream->unmap();
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandStream->buffer());
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)commandOffset, (GLsizei)m_commands.size(), 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		m_commandStream->advance();
+	}
+	else
+	{
+		for(size_t i = 0; i < m_commands.size(); i++)
+		{
+			DrawElementsIndirectCommand const& command = m_commands[i];
+			void* indices = (void*)(command.firstIndex * sizeof(GLuint));
+			if(m_baseInstance)
+			{
+				glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, indices,
+															  command.instanceCount, command.baseVertex, command.baseInstance);
+			}
+			else
+			{
+				drawAttributes(drawOffset + command.baseInstance * sizeof(Draw));
+				glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, indices,
+												  command.instanceCount, command.baseVertex);
+			}
+		}
+	}
+
+	enableDrawAttributes(false);
+	m_drawStream->advance();
+}
+
+bool MeshBuffer::multiDrawIndirect() const
+{
+	return m_multiDrawIndirect;
+}
+
+void MeshBuffer::enableDrawAttributes(bool enabled)
+{
+	for(GLuint location = 2; location <= 9; location++)
+	{
+		if(enabled)
+			glEnableVertexAttribArray(location);
+		else
+			glDisableVertexAttribArray(location);
+	}
+}
+
+void MeshBuffer::drawAttributes(GLintptr offset)
+{
+	// instanceTransform and instanceNormalMatrix take one location per column,
+	// instanceMaterial is an integer attribute
+	glBindBuffer(GL_ARRAY_BUFFER, m_drawStream->buffer());
+	for(int column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, sizeof(Draw),
+							  (void*)(offset + offsetof(Draw, transform) + column * sizeof(glm::vec4)));
+	}
+	glVertexAttribIPointer(6, 1, GL_INT, sizeof(Draw), (void*)(offset + offsetof(Draw, material)));
+	for(int column = 0; column < 3; column++)
+	{
+		glVertexAttribPointer(7 + column, 3, GL_FLOAT, GL_FALSE, sizeof(Draw),
+							  (void*)(offset + offsetof(Draw, normalMatrix) + column * sizeof(glm::vec3)));
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
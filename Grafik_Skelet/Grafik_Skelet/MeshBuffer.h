@@ -0,0 +1,135 @@
+/** @file
+* All resident meshes suballocated in one vertex and index buffer, drawn with multi draw indirect.
+*/
+
+#ifndef MESH_BUFFER_H
+#define MESH_BUFFER_H
+
+#if defined(WIN32) || defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#endif
+
+#if defined(__APPLE__) && defined(__MACH__)
+	#include <OpenGL/glew.h>
+	#include <OpenGL/gl.h>
+	#include <OpenGL/glu.h>
+#else
+	#include <GL/glew.h>
+	#include <GL/gl.h>
+	#include <GL/glu.h>
+#endif
+
+#include <vector>
+
+#include "glmutils.h"
+#include "StreamBuffer.h"
+#include "WeldedMesh.h"
+
+/**
+* Every mesh is welded and appended to the shared buffers, so all of them are
+* drawn from one vertex array object. A draw added with addDraw() has the same
+* per instance attributes as an InstancedMesh, a model matrix, its normal matrix
+* and an index into the InstanceMaterials block, and drawAll() issues all of them at once:
+*
+* - GL 4.3 or ARB_multi_draw_indirect: the commands are written to a
+*   GL_DRAW_INDIRECT_BUFFER and drawn with one glMultiDrawElementsIndirect,
+*   where the base instance of each command selects its attributes.
+* - GL 4.2 or ARB_base_instance: one glDrawElementsInstancedBaseVertexBaseInstance per draw.
+* - GL 3.3: the per draw attributes are pointed at the draw before each
+*   glDrawElementsInstancedBaseVertex.
+*
+* The draws and commands of a frame are written to StreamBuffers.
+*/
+class MeshBuffer
+{
+	public:
+		MeshBuffer();
+		~MeshBuffer();
+
+		/**
+		* Appends the triangles given as triples of vertices, with a normal per vertex.
+		* The shared buffers are uploaded by the next upload().
+		* @return the handle of the mesh
+		*/
+		int addMesh(std::vector<glm::vec3> const& vertices, std::vector<glm::vec3> const& normals);
+
+		GLsizei indexCount(int mesh) const;
+		glm::vec3 const& boundsMin(int mesh) const;
+		glm::vec3 const& boundsMax(int mesh) const;
+
+		GLuint firstIndex(int mesh) const;
+		GLint baseVertex(int mesh) const;
+
+		/**
+		* The shared vertex array, a mesh is drawn from it with glDrawElementsBaseVertex
+		* by a program which does not read the per draw attributes
+		*/
+		GLuint vertexArray() const;
+
+		/** Uploads the meshes added since the last upload */
+		void upload();
+
+		/** Starts collecting the draws of a frame */
+		void clearDraws();
+		void addDraw(int mesh, glm::mat4x4 const& transform, int material);
+		GLsizei drawCount() const;
+
+		/** Issues all the draws collected since clearDraws() with the bound program and vertexArray() */
+		void drawAll();
+
+		/** True when all the draws are issued with one glMultiDrawElementsIndirect */
+		bool multiDrawIndirect() const;
+
+	private:
+		struct Mesh
+		{
+			GLuint firstIndex;
+			GLsizei indexCount;
+			GLint baseVertex;
+			glm::vec3 boundsMin;
+			glm::vec3 boundsMax;
+		};
+
+		// The layout glMultiDrawElementsIndirect reads from the GL_DRAW_INDIRECT_BUFFER
+		struct DrawElementsIndirectCommand
+		{
+			GLuint count;
+			GLuint instanceCount;
+			GLuint firstIndex;
+			GLint baseVertex;
+			GLuint baseInstance;
+		};
+
+		// The per draw attributes, laid out like the instances of an InstancedMesh
+		struct Draw
+		{
+			glm::mat4x4 transform;
+			glm::mat3x3 normalMatrix;
+			GLint material;
+		};
+
+		void enableDrawAttributes(bool enabled);
+		// Points the per draw attributes at the draw at offset in the draw stream
+		void drawAttributes(GLintptr offset);
+
+		GLuint m_vertexArray;
+		GLuint m_vertexBuffer;
+		GLuint m_indexBuffer;
+		StreamBuffer* m_drawStream;
+		StreamBuffer* m_commandStream;
+
+		// Kept so the buffers can be uploaded again when a mesh is added
+		std::vector<WeldedVertex> m_vertices;
+		std::vector<GLuint> m_indices;
+		bool m_meshesDirty;
+
+		std::vector<Mesh> m_meshes;
+		std::vector<DrawElementsIndirectCommand> m_commands;
+		std::vector<Draw> m_draws;
+
+		bool m_multiDrawIndirect;
+		bool m_baseInstance;
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "Multi_view_renderer.h"
+#include <algorithm>
+#include <cmath>
+
+Multi_view_renderer::Multi_view_renderer(int view_width, int view_height)
+	: view_width(view_width), view_height(view_height), atlas_buffer(0, 0), atlas_dirty(true)
+{
+}
+
+Multi_view_renderer::~Multi_view_renderer(void)
+{
+	this->release();
+}
+
+void Multi_view_renderer::release()
+{
+	for (size_t i = 0; i < this->renderers.size(); i++) {
+		delete this->renderers[i];
+	}
+	this->renderers.clear();
+}
+
+void Multi_view_renderer::views(std::vector<Camera> const& cameras)
+{
+	this->release();
+	this->cameras = cameras;
+
+	for (size_t i = 0; i < this->cameras.size(); i++) {
+		Camera& camera = this->cameras[i];
+		camera.WindowWidth(this->view_width);
+		camera.WindowHeight(this->view_height);
+
+		Software_renderer* renderer = new Software_renderer(this->view_width, this->view_height);
+		renderer->shader() = this->phong_shader;
+		renderer->matrices(camera.ViewOrientation(), camera.ViewProjection(), camera.NormalMatrix(),
+						   camera.WindowViewport());
+		this->renderers.push_back(renderer);
+	}
+
+	int rows = this->columns() == 0 ? 0 : ((int)this->cameras.size() + this->columns() - 1) / this->columns();
+	this->atlas_buffer.resize(this->columns() * this->view_width, rows * this->view_height);
+	this->atlas_dirty = true;
+}
+
+int Multi_view_renderer::view_count() const
+{
+	return (int)this->renderers.size();
+}
+
+int Multi_view_renderer::columns() const
+{
+	// As square as possible
+	int count = (int)this->cameras.size();
+	int columns = (int)std::ceil(std::sqrt((double)count));
+	return columns;
+}
+
+void Multi_view_renderer::material(glm::vec3 const& ambient, glm::vec3 const& diffuse, glm::vec3 const& specular, float shiny)
+{
+	this->phong_shader.material(ambient, diffuse, specular, shiny);
+	for (size_t i = 0; i < this->renderers.size(); i++) {
+		this->renderers[i]->shader().material(ambient, diffuse, specular, shiny);
+	}
+}
+
+void Multi_view_renderer::light(glm::vec4 const& position, glm::vec3 const& ambient, glm::vec3 const& diffuse,
+								glm::vec3 const& specular)
+{
+	this->phong_shader.light(position, ambient, diffuse, specular);
+	for (size_t i = 0; i < this->renderers.size(); i++) {
+		this->renderers[i]->shader().light(position, ambient, diffuse, specular);
+	}
+}
+
+void Multi_view_renderer::clear(glm::vec4 const& color)
+{
+	for (size_t i = 0; i < this->renderers.size(); i++) {
+		this->renderers[i]->clear(color);
+	}
+	this->atlas_buffer.clear(Frame_buffer::pack(color.r, color.g, color.b, color.a));
+	this->atlas_dirty = true;
+}
+
+void Multi_view_renderer::draw_triangles(Vertex_arrays const& vertices)
+{
+	for (size_t i = 0; i < this->renderers.size(); i++) {
+		this->renderers[i]->draw_triangles(vertices);
+	}
+	this->atlas_dirty = true;
+}
+
+void Multi_view_renderer::draw_indexed_triangles(Vertex_arrays const& vertices, std::vector<unsigned int> const& indices)
+{
+	for (size_t i = 0; i < this->renderers.size(); i++) {
+		this->renderers[i]->draw_indexed_triangles(vertices, indices);
+	}
+	this->atlas_dirty = true;
+}
+
+Frame_buffer const& Multi_view_renderer::atlas()
+{
+	if (!this->atlas_dirty) {
+		return this->atlas_buffer;
+	}
+
+	int columns = this->columns();
+	int rows = this->atlas_buffer.height() / std::max(this->view_height, 1);
+	for (size_t i = 0; i < this->renderers.size(); i++) {
+		// Row 0 of the frame buffers is the bottom row, so the first row of views is at the top
+		int x = (int)i % columns * this->view_width;
+		int y = (rows - 1 - (int)i / columns) * this->view_height;
+
+		unsigned int const* source = this->renderers[i]->frame_buffer().data();
+		unsigned int* destination = this->atlas_buffer.data();
+		for (int row = 0; row < this->view_height; row++) {
+			std::copy(source + row * this->view_width, source + (row + 1) * this->view_width,
+					  destination + (y + row) * this->atlas_buffer.width() + x);
+		}
+	}
+	this->atlas_dirty = false;
+	return this->atlas_buffer;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <vector>
+
+#include "glmutils.h"
+#include "Camera.h"
+#include "Frame_buffer.h"
+#include "Software_renderer.h"
+
+/**
+* Renders the same meshes from several cameras with the software pipeline,
+* and puts the views side by side in one atlas, e.g. for sets of thumbnails.
+*
+* Every view has its own Software_renderer, so each mesh is transformed once
+* per view, but the meshes themselves, and the culling and tessellation done
+* to build them, are shared by all views instead of being redone per view.
+*/
+class Multi_view_renderer
+{
+public:
+	Multi_view_renderer(int view_width, int view_height);
+	virtual ~Multi_view_renderer(void);
+
+	// One view per camera, the window size of the cameras is set to the size of the views
+	void views(std::vector<Camera> const& cameras);
+	int view_count() const;
+
+	// Same material and light in every view
+	void material(glm::vec3 const& ambient, glm::vec3 const& diffuse, glm::vec3 const& specular, float shiny);
+	void light(glm::vec4 const& position, glm::vec3 const& ambient, glm::vec3 const& diffuse, glm::vec3 const& specular);
+
+	void clear(glm::vec4 const& color);
+
+	// Draws the triangles given as triples of vertices into every view
+	void draw_triangles(Vertex_arrays const& vertices);
+	// Draws the triangles given as triples of indices into every view
+	void draw_indexed_triangles(Vertex_arrays const& vertices, std::vector<unsigned int> const& indices);
+
+	// The views in rows of columns() views, with view 0 in the top left corner
+	Frame_buffer const& atlas();
+	int columns() const;
+private:
+	// Not copyable, the renderers are owned and deleted by release(). Declared but not defined
+	Multi_view_renderer(Multi_view_renderer const& other);
+	Multi_view_renderer& operator=(Multi_view_renderer const& other);
+
+	void release();
+
+	int view_width;
+	int view_height;
+
+	std::vector<Camera> cameras;
+	std::vector<Software_renderer*> renderers;
+
+	// Material and light for views which are created later
+	Phong_shader phong_shader;
+
+	Frame_buffer atlas_buffer;
+	bool atlas_dirty;
+};
+
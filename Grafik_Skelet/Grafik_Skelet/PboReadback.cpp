@@ -0,0 +1,93 @@
+/** @file
+* Asynchronous readback of the framebuffer through a ring of pixel buffer objects.
+*/
+
+#include "PboReadback.h"
+
+PboReadback::PboReadback(int numBuffers)
+{
+	m_slots.resize(numBuffers < 2 ? 2 : numBuffers);
+	for(size_t i = 0; i < m_slots.size(); i++)
+	{
+		glGenBuffers(1, &m_slots[i].buffer);
+		m_slots[i].size = 0;
+		m_slots[i].fence = 0;
+		m_slots[i].width = m_slots[i].height = 0;
+	}
+	m_oldest = 0;
+	m_pending = 0;
+}
+
+PboReadback::~PboReadback()
+{
+	for(size_t i = 0; i < m_slots.size(); i++)
+	{
+		if(m_slots[i].fence != 0)
+			glDeleteSync(m_slots[i].fence);
+		glDeleteBuffers(1, &m_slots[i].buffer);
+	}
+}
+
+void PboReadback::readFrame(GLint width, GLint height, Frame_writer* writer)
+{
+	// Only wait for the GPU when every buffer of the ring is in use
+	if(m_pending == (int)m_slots.size())
+		retireOldest(true, writer);
+
+	Slot& slot = m_slots[(m_oldest + m_pending) % m_slots.size()];
+	GLsizeiptr size = (GLsizeiptr)width * height * 4;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	if(slot.size != size) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+		slot.size = size;
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.width = width;
+	slot.height = height;
+	m_pending++;
+
+	// Hand over the frames which are already done, without blocking
+	while(m_pending > 0)
+	{
+		GLenum status = glClientWaitSync(m_slots[m_oldest].fence, 0, 0);
+		if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		retireOldest(false, writer);
+	}
+}
+
+void PboReadback::flush(Frame_writer* writer)
+{
+	while(m_pending > 0)
+		retireOldest(true, writer);
+}
+
+void PboReadback::retireOldest(bool wait, Frame_writer* writer)
+{
+	Slot& slot = m_slots[m_oldest];
+
+	if(wait) {
+		// Wait in steps of 1 ms, the flush bit makes sure the fence is ever reached
+		GLenum status = GL_TIMEOUT_EXPIRED;
+		while(status == GL_TIMEOUT_EXPIRED)
+			status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+	}
+	glDeleteSync(slot.fence);
+	slot.fence = 0;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.size, GL_MAP_READ_BIT);
+	if(pixels != NULL) {
+		writer->write((unsigned int const*)pixels, slot.width, slot.height);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_oldest = (m_oldest + 1) % m_slots.size();
+	m_pending--;
+}
@@ -0,0 +1,61 @@
+/** @file
+* Asynchronous readback of the framebuffer through a ring of pixel buffer objects.
+*/
+
+#ifndef PBO_READBACK_H
+#define PBO_READBACK_H
+
+#if defined(WIN32) || defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#endif
+
+#if defined(__APPLE__) && defined(__MACH__)
+	#include <OpenGL/glew.h>
+	#include <OpenGL/gl.h>
+	#include <OpenGL/glu.h>
+#else
+	#include <GL/glew.h>
+	#include <GL/gl.h>
+	#include <GL/glu.h>
+#endif
+
+#include <vector>
+
+#include "Frame_writer.h"
+
+/**
+* glReadPixels into a pixel buffer object only queues the copy on the GPU,
+* so the frames are read into a ring of buffers and mapped a few frames later
+* when a fence shows that the copy is done. The mapped pixels are handed to
+* a Frame_writer, which encodes them on its own thread.
+*/
+class PboReadback
+{
+	public:
+		PboReadback(int numBuffers);
+		~PboReadback();
+
+		// Starts reading the color buffer of the current framebuffer, and hands
+		// the frames which have arrived since the last call to the writer
+		void readFrame(GLint width, GLint height, Frame_writer* writer);
+		// Waits for all frames which are still being read and hands them to the writer
+		void flush(Frame_writer* writer);
+
+	private:
+		struct Slot {
+			GLuint buffer;
+			GLsizeiptr size;
+			GLsync fence;
+			GLint width, height;
+		};
+
+		void retireOldest(bool wait, Frame_writer* writer);
+
+	private:
+		std::vector<Slot> m_slots;
+		int m_oldest;
+		int m_pending;
+};
+
+#endif
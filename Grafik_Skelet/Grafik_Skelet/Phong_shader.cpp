@@ -0,0 +1,370 @@
+#include "Phong_shader.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(PHONG_SHADER_AVX2)
+	#include <immintrin.h>
+#elif defined(PHONG_SHADER_SSE2)
+	#include <emmintrin.h>
+#endif
+
+Phong_shader::Phong_shader(void)
+	: mat_ambient(0.0f), mat_diffuse(0.0f), mat_specular(0.0f), mat_shiny(1.0f),
+	  light_position(0.0f, 0.0f, 0.0f, 1.0f), light_ambient(0.0f), light_diffuse(0.0f), light_specular(0.0f),
+	  model(1.0f)
+{
+	this->update();
+}
+
+Phong_shader::~Phong_shader(void)
+{
+}
+
+void Phong_shader::material(glm::vec3 const& ambient, glm::vec3 const& diffuse, glm::vec3 const& specular, float shiny)
+{
+	this->mat_ambient = ambient;
+	this->mat_diffuse = diffuse;
+	this->mat_specular = specular;
+	this->mat_shiny = shiny;
+	this->update();
+}
+
+void Phong_shader::light(glm::vec4 const& position, glm::vec3 const& ambient, glm::vec3 const& diffuse, glm::vec3 const& specular)
+{
+	this->light_position = position;
+	this->light_ambient = ambient;
+	this->light_diffuse = diffuse;
+	this->light_specular = specular;
+	this->update();
+}
+
+void Phong_shader::model_matrix(glm::mat4x4 const& model_matrix)
+{
+	this->model = model_matrix;
+	this->update();
+}
+
+void Phong_shader::update()
+{
+	this->eye_light_position = glm::vec3(this->model * this->light_position);
+	this->ambient = this->mat_ambient * this->light_ambient;
+	this->front_diffuse = this->mat_diffuse * this->light_diffuse;
+	this->back_diffuse = (glm::vec3(1.0f) - this->mat_diffuse) * this->light_diffuse;
+	this->specular = this->mat_specular * this->light_specular;
+}
+
+glm::vec3 Phong_shader::shade(glm::vec3 const& position, glm::vec3 const& normal, bool front_facing) const
+{
+	glm::vec3 n = front_facing ? -glm::normalize(normal) : glm::normalize(normal);
+	glm::vec3 s = glm::normalize(this->eye_light_position - position);
+	glm::vec3 v = glm::normalize(-position);
+	glm::vec3 r = glm::reflect(-s, n);
+
+	glm::vec3 diffuse = front_facing ? this->front_diffuse : this->back_diffuse;
+	return this->ambient +
+		   diffuse * std::max(glm::dot(s, n), 0.0f) +
+		   this->specular * std::pow(std::max(glm::dot(r, v), 0.0f), this->mat_shiny);
+}
+
+void Phong_shader::shade(Fragment_batch const& batch) const
+{
+#if defined(PHONG_SHADER_AVX2)
+	this->shade_avx2(batch, 0, batch.count);
+#elif defined(PHONG_SHADER_SSE2)
+	this->shade_sse2(batch, 0, batch.count);
+#else
+	this->shade_scalar(batch, 0, batch.count);
+#endif
+}
+
+void Phong_shader::shade_scalar(Fragment_batch const& batch, int begin, int end) const
+{
+	for (int i = begin; i < end; i++) {
+		glm::vec3 color = this->shade(glm::vec3(batch.px[i], batch.py[i], batch.pz[i]),
+									  glm::vec3(batch.nx[i], batch.ny[i], batch.nz[i]),
+									  batch.front_facing[i] != 0);
+		batch.r[i] = color.r;
+		batch.g[i] = color.g;
+		batch.b[i] = color.b;
+	}
+}
+
+#if defined(PHONG_SHADER_AVX2)
+
+// log2(x) for x > 0, from the exponent bits and a polynomial in the mantissa
+static inline __m256 log2_ps(__m256 x)
+{
+	__m256i bits = _mm256_castps_si256(x);
+	__m256 exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+	// Mantissa m in [1, 2), and t = m - 1
+	__m256 t = _mm256_sub_ps(_mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)),
+																 _mm256_set1_epi32(0x3f800000))),
+							 _mm256_set1_ps(1.0f));
+	// Polynomial for log2(1 + t) / t on [0, 1)
+	__m256 p = _mm256_set1_ps(0.02001665f);
+	p = _mm256_add_ps(_mm256_mul_ps(p, t), _mm256_set1_ps(-0.0946268097f));
+	p = _mm256_add_ps(_mm256_mul_ps(p, t), _mm256_set1_ps(0.213943212f));
+	p = _mm256_add_ps(_mm256_mul_ps(p, t), _mm256_set1_ps(-0.338377198f));
+	p = _mm256_add_ps(_mm256_mul_ps(p, t), _mm256_set1_ps(0.477496364f));
+	p = _mm256_add_ps(_mm256_mul_ps(p, t), _mm256_set1_ps(-0.721144092f));
+	p = _mm256_add_ps(_mm256_mul_ps(p, t), _mm256_set1_ps(1.44269298f));
+	return _mm256_add_ps(_mm256_mul_ps(p, t), exponent);
+}
+
+// 2^x, from the integer part in the exponent bits and a polynomial for the fraction
+static inline __m256 exp2_ps(__m256 x)
+{
+	x = _mm256_max_ps(_mm256_min_ps(x, _mm256_set1_ps(127.0f)), _mm256_set1_ps(-126.0f));
+	__m256 whole = _mm256_floor_ps(x);
+	__m256 f = _mm256_sub_ps(x, whole);
+	// Polynomial for 2^f on [0, 1)
+	__m256 p = _mm256_set1_ps(0.00189375406f);
+	p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(0.00894959042f));
+	p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(0.0558603371f));
+	p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(0.240141818f));
+	p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(0.69315449f));
+	p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(0.999999898f));
+	__m256i exponent = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(whole), _mm256_set1_epi32(127)), 23);
+	return _mm256_mul_ps(p, _mm256_castsi256_ps(exponent));
+}
+
+// x^y for x >= 0, where 0^y = 0
+static inline __m256 pow_ps(__m256 x, __m256 y)
+{
+	__m256 positive = _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GT_OQ);
+	__m256 result = exp2_ps(_mm256_mul_ps(y, log2_ps(_mm256_max_ps(x, _mm256_set1_ps(1.0e-30f)))));
+	return _mm256_and_ps(result, positive);
+}
+
+static inline __m256 rsqrt_ps(__m256 x)
+{
+	// One Newton-Raphson step on the hardware estimate
+	__m256 y = _mm256_rsqrt_ps(x);
+	__m256 yyx = _mm256_mul_ps(_mm256_mul_ps(y, y), x);
+	return _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), y), _mm256_sub_ps(_mm256_set1_ps(3.0f), yyx));
+}
+
+static inline __m256 dot3_ps(__m256 ax, __m256 ay, __m256 az, __m256 bx, __m256 by, __m256 bz)
+{
+	return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, bx), _mm256_mul_ps(ay, by)), _mm256_mul_ps(az, bz));
+}
+
+void Phong_shader::shade_avx2(Fragment_batch const& batch, int begin, int end) const
+{
+	__m256 zero = _mm256_setzero_ps();
+	__m256 sign = _mm256_set1_ps(-0.0f);
+	__m256 shiny = _mm256_set1_ps(this->mat_shiny);
+	__m256 lx = _mm256_set1_ps(this->eye_light_position.x);
+	__m256 ly = _mm256_set1_ps(this->eye_light_position.y);
+	__m256 lz = _mm256_set1_ps(this->eye_light_position.z);
+
+	for (int i = begin; i < end; i += 8) {
+		// The last fragments are padded to a full vector
+		float tail[6][8];
+		unsigned char tail_front[8];
+		float const* px = batch.px + i; float const* py = batch.py + i; float const* pz = batch.pz + i;
+		float const* nx = batch.nx + i; float const* ny = batch.ny + i; float const* nz = batch.nz + i;
+		unsigned char const* front = batch.front_facing + i;
+		int count = std::min(8, end - i);
+		if (count < 8) {
+			for (int k = 0; k < 8; k++) {
+				int j = std::min(k, count - 1);
+				tail[0][k] = px[j]; tail[1][k] = py[j]; tail[2][k] = pz[j];
+				tail[3][k] = nx[j]; tail[4][k] = ny[j]; tail[5][k] = nz[j];
+				tail_front[k] = front[j];
+			}
+			px = tail[0]; py = tail[1]; pz = tail[2];
+			nx = tail[3]; ny = tail[4]; nz = tail[5];
+			front = tail_front;
+		}
+
+		__m256 Px = _mm256_loadu_ps(px), Py = _mm256_loadu_ps(py), Pz = _mm256_loadu_ps(pz);
+		__m256 Nx = _mm256_loadu_ps(nx), Ny = _mm256_loadu_ps(ny), Nz = _mm256_loadu_ps(nz);
+
+		// Front facing mask from the 8 bytes
+		__m256i front_words = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const*)front));
+		__m256 is_front = _mm256_castsi256_ps(_mm256_cmpgt_epi32(front_words, _mm256_setzero_si256()));
+
+		// n = normalize(N), negated for front faces
+		__m256 n_scale = rsqrt_ps(dot3_ps(Nx, Ny, Nz, Nx, Ny, Nz));
+		n_scale = _mm256_xor_ps(n_scale, _mm256_and_ps(is_front, sign));
+		Nx = _mm256_mul_ps(Nx, n_scale); Ny = _mm256_mul_ps(Ny, n_scale); Nz = _mm256_mul_ps(Nz, n_scale);
+
+		// s = normalize(light - P)
+		__m256 Sx = _mm256_sub_ps(lx, Px), Sy = _mm256_sub_ps(ly, Py), Sz = _mm256_sub_ps(lz, Pz);
+		__m256 s_scale = rsqrt_ps(dot3_ps(Sx, Sy, Sz, Sx, Sy, Sz));
+		Sx = _mm256_mul_ps(Sx, s_scale); Sy = _mm256_mul_ps(Sy, s_scale); Sz = _mm256_mul_ps(Sz, s_scale);
+
+		// v = normalize(-P)
+		__m256 v_scale = _mm256_xor_ps(rsqrt_ps(dot3_ps(Px, Py, Pz, Px, Py, Pz)), sign);
+		__m256 Vx = _mm256_mul_ps(Px, v_scale), Vy = _mm256_mul_ps(Py, v_scale), Vz = _mm256_mul_ps(Pz, v_scale);
+
+		// r = reflect(-s, n) = 2 dot(n, s) n - s
+		__m256 sn = dot3_ps(Sx, Sy, Sz, Nx, Ny, Nz);
+		__m256 two_sn = _mm256_add_ps(sn, sn);
+		__m256 Rx = _mm256_sub_ps(_mm256_mul_ps(two_sn, Nx), Sx);
+		__m256 Ry = _mm256_sub_ps(_mm256_mul_ps(two_sn, Ny), Sy);
+		__m256 Rz = _mm256_sub_ps(_mm256_mul_ps(two_sn, Nz), Sz);
+
+		__m256 diffuse_term = _mm256_max_ps(sn, zero);
+		__m256 specular_term = pow_ps(_mm256_max_ps(dot3_ps(Rx, Ry, Rz, Vx, Vy, Vz), zero), shiny);
+
+		float* out[3] = { batch.r + i, batch.g + i, batch.b + i };
+		for (int c = 0; c < 3; c++) {
+			__m256 diffuse = _mm256_blendv_ps(_mm256_set1_ps(this->back_diffuse[c]),
+											  _mm256_set1_ps(this->front_diffuse[c]), is_front);
+			__m256 color = _mm256_add_ps(_mm256_set1_ps(this->ambient[c]),
+								_mm256_add_ps(_mm256_mul_ps(diffuse, diffuse_term),
+											  _mm256_mul_ps(_mm256_set1_ps(this->specular[c]), specular_term)));
+			if (count == 8) {
+				_mm256_storeu_ps(out[c], color);
+			}
+			else {
+				float result[8];
+				_mm256_storeu_ps(result, color);
+				std::copy(result, result + count, out[c]);
+			}
+		}
+	}
+}
+
+#elif defined(PHONG_SHADER_SSE2)
+
+// The same approximations as the AVX2 path, 4 fragments wide
+
+static inline __m128 log2_ps(__m128 x)
+{
+	__m128i bits = _mm_castps_si128(x);
+	__m128 exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+	__m128 t = _mm_sub_ps(_mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+														_mm_set1_epi32(0x3f800000))),
+						  _mm_set1_ps(1.0f));
+	__m128 p = _mm_set1_ps(0.02001665f);
+	p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(-0.0946268097f));
+	p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(0.213943212f));
+	p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(-0.338377198f));
+	p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(0.477496364f));
+	p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(-0.721144092f));
+	p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(1.44269298f));
+	return _mm_add_ps(_mm_mul_ps(p, t), exponent);
+}
+
+static inline __m128 exp2_ps(__m128 x)
+{
+	x = _mm_max_ps(_mm_min_ps(x, _mm_set1_ps(127.0f)), _mm_set1_ps(-126.0f));
+	// SSE2 has no floor, so truncate and step down where that rounded a negative x up
+	__m128i truncated = _mm_cvttps_epi32(x);
+	__m128 whole = _mm_cvtepi32_ps(truncated);
+	__m128 rounded_up = _mm_cmpgt_ps(whole, x);
+	whole = _mm_sub_ps(whole, _mm_and_ps(rounded_up, _mm_set1_ps(1.0f)));
+	__m128 f = _mm_sub_ps(x, whole);
+	__m128 p = _mm_set1_ps(0.00189375406f);
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.00894959042f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.0558603371f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.240141818f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.69315449f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.999999898f));
+	__m128i exponent = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(whole), _mm_set1_epi32(127)), 23);
+	return _mm_mul_ps(p, _mm_castsi128_ps(exponent));
+}
+
+static inline __m128 pow_ps(__m128 x, __m128 y)
+{
+	__m128 positive = _mm_cmpgt_ps(x, _mm_setzero_ps());
+	__m128 result = exp2_ps(_mm_mul_ps(y, log2_ps(_mm_max_ps(x, _mm_set1_ps(1.0e-30f)))));
+	return _mm_and_ps(result, positive);
+}
+
+static inline __m128 rsqrt_ps(__m128 x)
+{
+	__m128 y = _mm_rsqrt_ps(x);
+	__m128 yyx = _mm_mul_ps(_mm_mul_ps(y, y), x);
+	return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), y), _mm_sub_ps(_mm_set1_ps(3.0f), yyx));
+}
+
+static inline __m128 dot3_ps(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+{
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+}
+
+void Phong_shader::shade_sse2(Fragment_batch const& batch, int begin, int end) const
+{
+	__m128 zero = _mm_setzero_ps();
+	__m128 sign = _mm_set1_ps(-0.0f);
+	__m128 shiny = _mm_set1_ps(this->mat_shiny);
+	__m128 lx = _mm_set1_ps(this->eye_light_position.x);
+	__m128 ly = _mm_set1_ps(this->eye_light_position.y);
+	__m128 lz = _mm_set1_ps(this->eye_light_position.z);
+
+	for (int i = begin; i < end; i += 4) {
+		// The last fragments are padded to a full vector
+		float tail[6][4];
+		unsigned char tail_front[4];
+		float const* px = batch.px + i; float const* py = batch.py + i; float const* pz = batch.pz + i;
+		float const* nx = batch.nx + i; float const* ny = batch.ny + i; float const* nz = batch.nz + i;
+		unsigned char const* front = batch.front_facing + i;
+		int count = std::min(4, end - i);
+		if (count < 4) {
+			for (int k = 0; k < 4; k++) {
+				int j = std::min(k, count - 1);
+				tail[0][k] = px[j]; tail[1][k] = py[j]; tail[2][k] = pz[j];
+				tail[3][k] = nx[j]; tail[4][k] = ny[j]; tail[5][k] = nz[j];
+				tail_front[k] = front[j];
+			}
+			px = tail[0]; py = tail[1]; pz = tail[2];
+			nx = tail[3]; ny = tail[4]; nz = tail[5];
+			front = tail_front;
+		}
+
+		__m128 Px = _mm_loadu_ps(px), Py = _mm_loadu_ps(py), Pz = _mm_loadu_ps(pz);
+		__m128 Nx = _mm_loadu_ps(nx), Ny = _mm_loadu_ps(ny), Nz = _mm_loadu_ps(nz);
+
+		// Front facing mask from the 4 bytes, widened to 32 bits
+		int front_bytes;
+		std::memcpy(&front_bytes, front, sizeof(front_bytes));
+		__m128i front_words = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(front_bytes), _mm_setzero_si128()),
+												 _mm_setzero_si128());
+		__m128 is_front = _mm_castsi128_ps(_mm_cmpgt_epi32(front_words, _mm_setzero_si128()));
+
+		__m128 n_scale = rsqrt_ps(dot3_ps(Nx, Ny, Nz, Nx, Ny, Nz));
+		n_scale = _mm_xor_ps(n_scale, _mm_and_ps(is_front, sign));
+		Nx = _mm_mul_ps(Nx, n_scale); Ny = _mm_mul_ps(Ny, n_scale); Nz = _mm_mul_ps(Nz, n_scale);
+
+		__m128 Sx = _mm_sub_ps(lx, Px), Sy = _mm_sub_ps(ly, Py), Sz = _mm_sub_ps(lz, Pz);
+		__m128 s_scale = rsqrt_ps(dot3_ps(Sx, Sy, Sz, Sx, Sy, Sz));
+		Sx = _mm_mul_ps(Sx, s_scale); Sy = _mm_mul_ps(Sy, s_scale); Sz = _mm_mul_ps(Sz, s_scale);
+
+		__m128 v_scale = _mm_xor_ps(rsqrt_ps(dot3_ps(Px, Py, Pz, Px, Py, Pz)), sign);
+		__m128 Vx = _mm_mul_ps(Px, v_scale), Vy = _mm_mul_ps(Py, v_scale), Vz = _mm_mul_ps(Pz, v_scale);
+
+		__m128 sn = dot3_ps(Sx, Sy, Sz, Nx, Ny, Nz);
+		__m128 two_sn = _mm_add_ps(sn, sn);
+		__m128 Rx = _mm_sub_ps(_mm_mul_ps(two_sn, Nx), Sx);
+		__m128 Ry = _mm_sub_ps(_mm_mul_ps(two_sn, Ny), Sy);
+		__m128 Rz = _mm_sub_ps(_mm_mul_ps(two_sn, Nz), Sz);
+
+		__m128 diffuse_term = _mm_max_ps(sn, zero);
+		__m128 specular_term = pow_ps(_mm_max_ps(dot3_ps(Rx, Ry, Rz, Vx, Vy, Vz), zero), shiny);
+
+		float* out[3] = { batch.r + i, batch.g + i, batch.b + i };
+		for (int c = 0; c < 3; c++) {
+			// Blend without SSE4.1 blendv
+			__m128 diffuse = _mm_or_ps(_mm_and_ps(is_front, _mm_set1_ps(this->front_diffuse[c])),
+									   _mm_andnot_ps(is_front, _mm_set1_ps(this->back_diffuse[c])));
+			__m128 color = _mm_add_ps(_mm_set1_ps(this->ambient[c]),
+							   _mm_add_ps(_mm_mul_ps(diffuse, diffuse_term),
+										  _mm_mul_ps(_mm_set1_ps(this->specular[c]), specular_term)));
+			if (count == 4) {
+				_mm_storeu_ps(out[c], color);
+			}
+			else {
+				float result[4];
+				_mm_storeu_ps(result, color);
+				std::copy(result, result + count, out[c]);
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,78 @@
+#pragma once
+#include "glmutils.h"
+
+#if defined(__AVX2__)
+	#define PHONG_SHADER_AVX2
+#elif defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+	#define PHONG_SHADER_SSE2
+#endif
+
+/**
+* A batch of fragments in structure-of-arrays layout. The positions and the
+* normals are the interpolated curVert and curNormalVec of Shader.vert, i.e.
+* in eye coordinates, and the colors are written to r, g and b.
+*/
+struct Fragment_batch
+{
+	float const* px; float const* py; float const* pz;
+	float const* nx; float const* ny; float const* nz;
+	unsigned char const* front_facing;
+
+	float* r; float* g; float* b;
+
+	int count;
+};
+
+/**
+* Evaluates the Phong reflection model of Shader.frag on the CPU, including
+* the inverted normals and the complementary diffuse color of the back faces.
+* When compiled with AVX2 the fragments are shaded 8 at a time, otherwise 4
+* at a time with SSE2, and pow(x, matShiny) is computed as
+* exp2(matShiny * log2(x)) with polynomial approximations, which is accurate
+* to well below 8-bit color precision.
+*/
+class Phong_shader
+{
+public:
+	Phong_shader(void);
+	virtual ~Phong_shader(void);
+
+	// Same parameters as the uniforms of Shader.frag
+	void material(glm::vec3 const& ambient, glm::vec3 const& diffuse, glm::vec3 const& specular, float shiny);
+	void light(glm::vec4 const& position, glm::vec3 const& ambient, glm::vec3 const& diffuse, glm::vec3 const& specular);
+	// The light position is transformed by this matrix, like viewMatrix in Shader.frag
+	void model_matrix(glm::mat4x4 const& model_matrix);
+
+	void shade(Fragment_batch const& batch) const;
+
+	// Shades one fragment without any approximations
+	glm::vec3 shade(glm::vec3 const& position, glm::vec3 const& normal, bool front_facing) const;
+private:
+	void shade_scalar(Fragment_batch const& batch, int begin, int end) const;
+#if defined(PHONG_SHADER_AVX2)
+	void shade_avx2(Fragment_batch const& batch, int begin, int end) const;
+#elif defined(PHONG_SHADER_SSE2)
+	void shade_sse2(Fragment_batch const& batch, int begin, int end) const;
+#endif
+
+	glm::vec3 mat_ambient;
+	glm::vec3 mat_diffuse;
+	glm::vec3 mat_specular;
+	float mat_shiny;
+
+	glm::vec4 light_position;
+	glm::vec3 light_ambient;
+	glm::vec3 light_diffuse;
+	glm::vec3 light_specular;
+
+	glm::mat4x4 model;
+
+	// Derived from the parameters above
+	void update();
+	glm::vec3 eye_light_position;
+	glm::vec3 ambient;
+	glm::vec3 front_diffuse;
+	glm::vec3 back_diffuse;
+	glm::vec3 specular;
+};
+
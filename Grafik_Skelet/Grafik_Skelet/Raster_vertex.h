@@ -0,0 +1,22 @@
+#pragma once
+
+// Maximum number of interpolated attributes (normals, colors, ...) per vertex
+const int MAX_RASTER_ATTRIBUTES = 8;
+
+/**
+* A vertex in window coordinates as it is handed to the rasterizers.
+* x and y are pixel coordinates, z is the window depth which is interpolated
+* linearly on the screen, and w is the clip coordinate w which is used to
+* make the interpolation of the attributes perspective correct.
+*/
+struct Raster_vertex
+{
+	Raster_vertex() : x(0), y(0), z(0.0f), w(1.0f), num_attributes(0) {}
+
+	int x; int y;
+	float z;
+	float w;
+
+	int num_attributes;
+	float attributes[MAX_RASTER_ATTRIBUTES];
+};
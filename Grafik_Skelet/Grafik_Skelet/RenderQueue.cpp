@@ -0,0 +1,191 @@
+/** @file
+* Draws submitted with a sort key, sorted every frame so the GL state changes as little as possible.
+*/
+
+#include "RenderQueue.h"
+
+#include "ShaderProgram.h"
+
+RenderItem::RenderItem()
+{
+	program = 0;
+	vertexArray = 0;
+	material = NULL;
+	modelView = NULL;
+	normalMatrix = NULL;
+	count = 0;
+	firstIndex = 0;
+	baseVertex = 0;
+	draw = NULL;
+	context = NULL;
+}
+
+RenderQueue::RenderQueue()
+{
+	m_programChanges = 0;
+	m_vertexArrayChanges = 0;
+	m_materialChanges = 0;
+}
+
+void RenderQueue::submit(RenderItem const& item, float depth)
+{
+	m_keys.push_back(sortKey(item, depth));
+	m_order.push_back((unsigned int)m_items.size());
+	m_items.push_back(item);
+}
+
+unsigned long long RenderQueue::sortKey(RenderItem const& item, float depth)
+{
+	// 16 bits of program, 12 of material, 12 of vertex array and 24 of depth
+	unsigned long long material = item.material != NULL ? item.material->buffer() : 0;
+	float clamped = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+	unsigned long long quantized = (unsigned long long)(clamped * 16777215.0f);
+
+	return ((unsigned long long)(item.program & 0xFFFF) << 48) |
+		   ((material & 0xFFF) << 36) |
+		   ((unsigned long long)(item.vertexArray & 0xFFF) << 24) |
+		   quantized;
+}
+
+void RenderQueue::sort()
+{
+	size_t count = m_keys.size();
+	m_sortedKeys.resize(count);
+	m_sortedOrder.resize(count);
+
+	// The histograms of all eight digits in one pass over the keys
+	size_t histograms[8][256] = {};
+	for(size_t i = 0; i < count; i++)
+	{
+		unsigned long long key = m_keys[i];
+		for(int digit = 0; digit < 8; digit++)
+			histograms[digit][(key >> (digit * 8)) & 0xFF]++;
+	}
+
+	// Least significant digit first, each pass is stable
+	for(int digit = 0; digit < 8; digit++)
+	{
+		size_t* histogram = histograms[digit];
+		int shift = digit * 8;
+
+		// A digit which is the same in all keys does not change the order
+		if(histogram[(m_keys[0] >> shift) & 0xFF] == count)
+			continue;
+
+		size_t offsets[256];
+		size_t offset = 0;
+		for(int value = 0; value < 256; value++)
+		{
+			offsets[value] = offset;
+			offset += histogram[value];
+		}
+
+		for(size_t i = 0; i < count; i++)
+		{
+			size_t destination = offsets[(m_keys[i] >> shift) & 0xFF]++;
+			m_sortedKeys[destination] = m_keys[i];
+			m_sortedOrder[destination] = m_order[i];
+		}
+		m_keys.swap(m_sortedKeys);
+		m_order.swap(m_sortedOrder);
+	}
+}
+
+void RenderQueue::flush(Camera const& camera)
+{
+	m_programChanges = 0;
+	m_vertexArrayChanges = 0;
+	m_materialChanges = 0;
+	if(m_items.empty())
+		return;
+
+	sort();
+
+	GLuint program = 0;
+	GLuint vertexArray = 0;
+	UniformBuffer const* material = NULL;
+	GLint modelViewLocation = -1;
+	GLint normalMatrixLocation = -1;
+	glm::mat4x4 const* modelView = NULL;
+	glm::mat3x3 const* normalMatrix = NULL;
+
+	for(size_t i = 0; i < m_order.size(); i++)
+	{
+		RenderItem const& item = m_items[m_order[i]];
+
+		if(i == 0 || item.program != program)
+		{
+			// The camera matrices are the same for all items drawn with the program
+			program = item.program;
+			glUseProgram(program);
+			GLint location = ShaderProgram::uniformLocation(program, "projectionMatrix");
+			if(location >= 0)
+				glUniformMatrix4fv(location, 1, GL_FALSE, &camera.ViewProjection()[0][0]);
+			location = ShaderProgram::uniformLocation(program, "viewMatrix");
+			if(location >= 0)
+				glUniformMatrix4fv(location, 1, GL_FALSE, &camera.ViewOrientation()[0][0]);
+
+			modelViewLocation = ShaderProgram::uniformLocation(program, "uModelMatrix");
+			normalMatrixLocation = ShaderProgram::uniformLocation(program, "normalvectorMatrix");
+			modelView = NULL;
+			normalMatrix = NULL;
+			m_programChanges++;
+		}
+		if(i == 0 || item.vertexArray != vertexArray)
+		{
+			vertexArray = item.vertexArray;
+			glBindVertexArray(vertexArray);
+			m_vertexArrayChanges++;
+		}
+		if(item.material != NULL && item.material != material)
+		{
+			material = item.material;
+			material->bind();
+			m_materialChanges++;
+		}
+
+		if(item.modelView != NULL && item.modelView != modelView)
+		{
+			modelView = item.modelView;
+			if(modelViewLocation >= 0)
+				glUniformMatrix4fv(modelViewLocation, 1, GL_FALSE, &(*modelView)[0][0]);
+		}
+		if(item.normalMatrix != NULL && item.normalMatrix != normalMatrix)
+		{
+			normalMatrix = item.normalMatrix;
+			if(normalMatrixLocation >= 0)
+				glUniformMatrix3fv(normalMatrixLocation, 1, GL_FALSE, &(*normalMatrix)[0][0]);
+		}
+
+		if(item.draw != NULL)
+			item.draw(item.context);
+		else
+			glDrawElementsBaseVertex(GL_TRIANGLES, item.count, GL_UNSIGNED_INT,
+									 (void*)(item.firstIndex * sizeof(GLuint)), item.baseVertex);
+	}
+	glBindVertexArray(0);
+
+	m_items.clear();
+	m_keys.clear();
+	m_order.clear();
+}
+
+int RenderQueue::size() const
+{
+	return (int)m_items.size();
+}
+
+int RenderQueue::programChanges() const
+{
+	return m_programChanges;
+}
+
+int RenderQueue::vertexArrayChanges() const
+{
+	return m_vertexArrayChanges;
+}
+
+int RenderQueue::materialChanges() const
+{
+	return m_materialChanges;
+}
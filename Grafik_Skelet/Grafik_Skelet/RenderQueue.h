@@ -0,0 +1,102 @@
+/** @file
+* Draws submitted with a sort key, sorted every frame so the GL state changes as little as possible.
+*/
+
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#if defined(WIN32) || defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#endif
+
+#if defined(__APPLE__) && defined(__MACH__)
+	#include <OpenGL/glew.h>
+	#include <OpenGL/gl.h>
+	#include <OpenGL/glu.h>
+#else
+	#include <GL/glew.h>
+	#include <GL/gl.h>
+	#include <GL/glu.h>
+#endif
+
+#include <vector>
+
+#include "glmutils.h"
+#include "Camera.h"
+#include "UniformBuffer.h"
+
+/**
+* The state a draw needs and the draw itself. The pointers must stay valid
+* until the queue is flushed.
+*/
+struct RenderItem
+{
+	RenderItem();
+
+	GLuint program;
+	GLuint vertexArray;
+	// Bound to its binding point, NULL leaves the bound material as it is
+	UniformBuffer const* material;
+
+	// Uploaded as uModelMatrix and normalvectorMatrix, NULL leaves them as they are
+	glm::mat4x4 const* modelView;
+	glm::mat3x3 const* normalMatrix;
+
+	// Triangles drawn with glDrawElementsBaseVertex from the vertex array
+	GLsizei count;
+	GLuint firstIndex;
+	GLint baseVertex;
+
+	// Or, when it is set, a draw of its own which is called with the state of the item set
+	void (*draw)(void* context);
+	void* context;
+};
+
+/**
+* Every item gets a 64 bit key with the program in the highest bits, then the
+* material, the vertex array and the depth, and flush() sorts the keys with a
+* radix sort. A program, vertex array or material is only bound when it differs
+* from the one of the item before, the camera matrices are set once per program,
+* and a model view matrix is not uploaded again for the next item which uses it.
+* Items with the same state are drawn front to back.
+*/
+class RenderQueue
+{
+	public:
+		RenderQueue();
+
+		/** depth is 0 at the front plane of the camera and 1 at the back plane */
+		void submit(RenderItem const& item, float depth);
+
+		/** Draws the items in the order of their keys and empties the queue */
+		void flush(Camera const& camera);
+
+		int size() const;
+
+		/** Number of times the state was changed by the last flush() */
+		int programChanges() const;
+		int vertexArrayChanges() const;
+		int materialChanges() const;
+
+		/** The bits of the names which are too large for their field are dropped, which only affects the order */
+		static unsigned long long sortKey(RenderItem const& item, float depth);
+
+	private:
+		// Sorts m_keys and m_order by the keys
+		void sort();
+
+		std::vector<RenderItem> m_items;
+		std::vector<unsigned long long> m_keys;
+		std::vector<unsigned int> m_order;
+
+		// The other half of each pass of the radix sort
+		std::vector<unsigned long long> m_sortedKeys;
+		std::vector<unsigned int> m_sortedOrder;
+
+		int m_programChanges;
+		int m_vertexArrayChanges;
+		int m_materialChanges;
+};
+
+#endif
@@ -0,0 +1,251 @@
+/** @file
+* A retained scene of meshes, materials and nodes which persists across frames.
+*/
+
+#include "Scene.h"
+
+Scene::Scene()
+{
+	m_meshBuffer = new MeshBuffer();
+	m_lights = new UniformBuffer(LIGHT_BLOCK_BINDING, sizeof(LightBlock));
+	m_materialTable = InstanceMaterialBlock();
+	m_instanceMaterials = new UniformBuffer(INSTANCE_MATERIAL_BLOCK_BINDING, sizeof(InstanceMaterialBlock));
+	m_instanceMaterials->update(&m_materialTable);
+	m_camera = NULL;
+	m_cameraRevision = 0;
+	m_drawnNodes = 0;
+	m_culledNodes = 0;
+}
+
+Scene::~Scene()
+{
+	delete m_meshBuffer;
+	for(size_t i = 0; i < m_materials.size(); i++)
+		delete m_materials[i];
+	for(size_t i = 0; i < m_instancedMeshes.size(); i++)
+		delete m_instancedMeshes[i];
+	delete m_lights;
+	delete m_instanceMaterials;
+}
+
+int Scene::addMesh(std::vector<glm::vec3> const& vertices, std::vector<glm::vec3> const& normals)
+{
+	return m_meshBuffer->addMesh(vertices, normals);
+}
+
+int Scene::addMaterial(MaterialBlock const& material)
+{
+	UniformBuffer* buffer = new UniformBuffer(MATERIAL_BLOCK_BINDING, sizeof(MaterialBlock));
+	m_materials.push_back(buffer);
+	int handle = (int)m_materials.size() - 1;
+	setMaterial(handle, material);
+	return handle;
+}
+
+void Scene::setMaterial(int material, MaterialBlock const& block)
+{
+	m_materials[material]->update(&block);
+	if(material < MAX_INSTANCE_MATERIALS)
+	{
+		m_materialTable.materials[material] = block;
+		m_instanceMaterials->update(&m_materialTable);
+	}
+}
+
+int Scene::addNode(int mesh, int material, glm::mat4x4 const& transform, GLuint program)
+{
+	Node node;
+	node.mesh = mesh;
+	node.material = material;
+	node.program = program;
+	node.transform = transform;
+	node.visible = true;
+	node.matricesDirty = true;
+	m_nodes.push_back(node);
+
+	m_bounds.resize(m_nodes.size());
+	updateBounds((int)m_nodes.size() - 1);
+	return (int)m_nodes.size() - 1;
+}
+
+void Scene::setTransform(int node, glm::mat4x4 const& transform)
+{
+	if(m_nodes[node].transform == transform)
+		return;
+	m_nodes[node].transform = transform;
+	m_nodes[node].matricesDirty = true;
+	updateBounds(node);
+}
+
+void Scene::setNodeMaterial(int node, int material)
+{
+	m_nodes[node].material = material;
+}
+
+void Scene::setNodeProgram(int node, GLuint program)
+{
+	m_nodes[node].program = program;
+}
+
+void Scene::setVisible(int node, bool visible)
+{
+	m_nodes[node].visible = visible;
+}
+
+void Scene::setLights(LightBlock const& lights)
+{
+	m_lights->update(&lights);
+}
+
+int Scene::addInstancedMesh(std::vector<glm::vec3> const& vertices, std::vector<glm::vec3> const& normals)
+{
+	m_instancedMeshes.push_back(new InstancedMesh(vertices, normals));
+	return (int)m_instancedMeshes.size() - 1;
+}
+
+void Scene::setInstances(int mesh, std::vector<glm::mat4x4> const& transforms, std::vector<int> const& materials)
+{
+	m_instancedMeshes[mesh]->setInstances(transforms, materials);
+}
+
+int Scene::drawnNodes() const
+{
+	return m_drawnNodes;
+}
+
+int Scene::culledNodes() const
+{
+	return m_culledNodes;
+}
+
+RenderQueue const& Scene::queue() const
+{
+	return m_queue;
+}
+
+void Scene::updateBounds(int node)
+{
+	// The bounds of the transformed corners of the mesh bounds
+	glm::vec3 const& boundsMin = m_meshBuffer->boundsMin(m_nodes[node].mesh);
+	glm::vec3 const& boundsMax = m_meshBuffer->boundsMax(m_nodes[node].mesh);
+	glm::vec3 corners[8];
+	for(int i = 0; i < 8; i++)
+	{
+		glm::vec4 corner((i & 1) ? boundsMax.x : boundsMin.x,
+						 (i & 2) ? boundsMax.y : boundsMin.y,
+						 (i & 4) ? boundsMax.z : boundsMin.z, 1.0f);
+		corners[i] = glm::vec3(m_nodes[node].transform * corner);
+	}
+	m_bounds.set(node, corners, 8);
+}
+
+float Scene::depth(int node, Camera const& camera) const
+{
+	// The center of the mesh bounds in clip coordinates, the front plane is at z = w
+	int mesh = m_nodes[node].mesh;
+	glm::vec4 center((m_meshBuffer->boundsMin(mesh) + m_meshBuffer->boundsMax(mesh)) * 0.5f, 1.0f);
+	glm::vec4 clip = camera.ViewProjection() * (m_nodes[node].modelView * center);
+	if(clip.w <= 0.0f)
+		return 0.0f;
+	return (1.0f - clip.z / clip.w) * 0.5f;
+}
+
+// The draws of the queue items which are not a single mesh
+static void drawMeshBuffer(void* context)
+{
+	((MeshBuffer*)context)->drawAll();
+}
+
+static void drawInstancedMesh(void* context)
+{
+	((InstancedMesh const*)context)->draw();
+}
+
+void Scene::draw(Camera const& camera, GLuint defaultProgram, GLuint instancedProgram)
+{
+	// The eye space matrices of all nodes depend on the camera
+	if(&camera != m_camera || camera.Revision() != m_cameraRevision)
+	{
+		for(size_t i = 0; i < m_nodes.size(); i++)
+			m_nodes[i].matricesDirty = true;
+		m_camera = &camera;
+		m_cameraRevision = camera.Revision();
+	}
+
+	Frustum_culler culler;
+	culler.planes(camera.ClipPlanes());
+	culler.cull(m_bounds, m_visibleNodes);
+
+	m_meshBuffer->upload();
+	m_meshBuffer->clearDraws();
+
+	m_drawnNodes = 0;
+	m_culledNodes = 0;
+	for(size_t i = 0; i < m_nodes.size(); i++)
+	{
+		Node& node = m_nodes[i];
+		if(!node.visible || m_meshBuffer->indexCount(node.mesh) == 0)
+			continue;
+		if(!Frustum_culler::is_set(m_visibleNodes, (int)i))
+		{
+			m_culledNodes++;
+			continue;
+		}
+		m_drawnNodes++;
+
+		// The model matrix and material index of a batched node are per draw attributes
+		if(instancedProgram != 0 && node.program == 0 && node.material < MAX_INSTANCE_MATERIALS)
+		{
+			m_meshBuffer->addDraw(node.mesh, node.transform, node.material);
+			continue;
+		}
+
+		if(node.matricesDirty)
+		{
+			node.modelView = camera.ViewOrientation() * node.transform;
+			node.normalMatrix = glm::transpose(glm::inverse(glm::mat3(node.modelView)));
+			node.matricesDirty = false;
+		}
+
+		RenderItem item;
+		item.program = node.program != 0 ? node.program : defaultProgram;
+		item.vertexArray = m_meshBuffer->vertexArray();
+		item.material = m_materials[node.material];
+		item.modelView = &node.modelView;
+		item.normalMatrix = &node.normalMatrix;
+		item.count = m_meshBuffer->indexCount(node.mesh);
+		item.firstIndex = m_meshBuffer->firstIndex(node.mesh);
+		item.baseVertex = m_meshBuffer->baseVertex(node.mesh);
+		m_queue.submit(item, depth((int)i, camera));
+	}
+
+	// The batch and the instances are transformed to world coordinates by the shader,
+	// so their model view matrix is the camera's own, and their materials are in the
+	// InstanceMaterials block
+	RenderItem instanced;
+	instanced.program = instancedProgram;
+	instanced.modelView = &camera.ViewOrientation();
+	instanced.normalMatrix = &camera.NormalMatrix();
+
+	if(m_meshBuffer->drawCount() > 0)
+	{
+		RenderItem item = instanced;
+		item.vertexArray = m_meshBuffer->vertexArray();
+		item.draw = drawMeshBuffer;
+		item.context = m_meshBuffer;
+		m_queue.submit(item, 0.0f);
+	}
+
+	for(size_t i = 0; instancedProgram != 0 && i < m_instancedMeshes.size(); i++)
+	{
+		if(m_instancedMeshes[i]->instanceCount() == 0)
+			continue;
+		RenderItem item = instanced;
+		item.vertexArray = m_instancedMeshes[i]->vertexArray();
+		item.draw = drawInstancedMesh;
+		item.context = m_instancedMeshes[i];
+		m_queue.submit(item, 0.0f);
+	}
+
+	m_queue.flush(camera);
+}
@@ -0,0 +1,149 @@
+/** @file
+* A retained scene of meshes, materials and nodes which persists across frames.
+*/
+
+#ifndef SCENE_H
+#define SCENE_H
+
+#if defined(WIN32) || defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#endif
+
+#if defined(__APPLE__) && defined(__MACH__)
+	#include <OpenGL/glew.h>
+	#include <OpenGL/gl.h>
+	#include <OpenGL/glu.h>
+#else
+	#include <GL/glew.h>
+	#include <GL/gl.h>
+	#include <GL/glu.h>
+#endif
+
+#include <vector>
+
+#include "glmutils.h"
+#include "Camera.h"
+#include "Frustum_culler.h"
+#include "InstancedMesh.h"
+#include "MeshBuffer.h"
+#include "RenderQueue.h"
+#include "SceneUniforms.h"
+#include "UniformBuffer.h"
+
+/**
+* Meshes are suballocated in one MeshBuffer when they are added, and every material
+* has its own uniform buffer which is only uploaded again when the material changes.
+* The materials are also the entries of the InstanceMaterials block, so a material
+* handle is the material index of an instance.
+* A node draws a mesh with a material and a transform; its eye space matrices
+* and world space bounds are only recomputed when the node or the camera changed.
+*
+* draw() culls the nodes against the camera. When it is given a program of the
+* INSTANCED variant, the nodes without a program of their own are drawn with it
+* by one MeshBuffer::drawAll(); the rest are drawn one by one. Those, the batch
+* and the instanced meshes are submitted to a RenderQueue, which sorts them by
+* program, material, vertex array and depth, so each is only bound once per run.
+*/
+class Scene
+{
+	public:
+		Scene();
+		~Scene();
+
+		/**
+		* Uploads the triangles given as triples of vertices, with a normal per vertex.
+		* @return the handle of the mesh
+		*/
+		int addMesh(std::vector<glm::vec3> const& vertices, std::vector<glm::vec3> const& normals);
+
+		/**
+		* Materials from MAX_INSTANCE_MATERIALS on have no entry in the InstanceMaterials
+		* block, their nodes are always drawn one by one.
+		* @return the handle of the material
+		*/
+		int addMaterial(MaterialBlock const& material);
+		void setMaterial(int material, MaterialBlock const& block);
+
+		/**
+		* Adds a node which draws the mesh with the material, transformed from model to world coordinates.
+		* Program 0 draws the node with the program given to draw().
+		* @return the handle of the node
+		*/
+		int addNode(int mesh, int material, glm::mat4x4 const& transform, GLuint program = 0);
+		void setTransform(int node, glm::mat4x4 const& transform);
+		void setNodeMaterial(int node, int material);
+		void setNodeProgram(int node, GLuint program);
+		void setVisible(int node, bool visible);
+
+		/** The lights in world coordinates, uploaded only when they change */
+		void setLights(LightBlock const& lights);
+
+		/**
+		* Adds a mesh which is drawn once per instance, see InstancedMesh.
+		* @return the handle of the instanced mesh
+		*/
+		int addInstancedMesh(std::vector<glm::vec3> const& vertices, std::vector<glm::vec3> const& normals);
+		/** materials[i] is the handle of the material of instance i */
+		void setInstances(int mesh, std::vector<glm::mat4x4> const& transforms, std::vector<int> const& materials);
+
+		/**
+		* Draws the nodes, and the instanced meshes with instancedProgram, which must be
+		* a linked program of the INSTANCED variant of the shaders. With 0 the nodes are
+		* drawn one by one with defaultProgram and the instanced meshes are not drawn.
+		*/
+		void draw(Camera const& camera, GLuint defaultProgram, GLuint instancedProgram = 0);
+
+		/** Number of nodes drawn and culled by the last draw() */
+		int drawnNodes() const;
+		int culledNodes() const;
+
+		/** The state changes of the last draw() */
+		RenderQueue const& queue() const;
+
+	private:
+		struct Node
+		{
+			int mesh;
+			int material;
+			GLuint program;
+			glm::mat4x4 transform;
+			bool visible;
+
+			// Derived from the transform and the camera
+			glm::mat4x4 modelView;
+			glm::mat3x3 normalMatrix;
+			bool matricesDirty;
+		};
+
+		void updateBounds(int node);
+		// From 0 at the front plane to 1 at the back plane, for the node with up to date matrices
+		float depth(int node, Camera const& camera) const;
+
+		MeshBuffer* m_meshBuffer;
+		std::vector<UniformBuffer*> m_materials;
+		std::vector<Node> m_nodes;
+
+		// World space bounds of the nodes, indexed like m_nodes
+		Bounding_boxes m_bounds;
+		std::vector<unsigned int> m_visibleNodes;
+
+		RenderQueue m_queue;
+
+		UniformBuffer* m_lights;
+
+		std::vector<InstancedMesh*> m_instancedMeshes;
+
+		// The first MAX_INSTANCE_MATERIALS materials
+		InstanceMaterialBlock m_materialTable;
+		UniformBuffer* m_instanceMaterials;
+
+		// The camera the matrices of the nodes were computed for
+		Camera const* m_camera;
+		unsigned int m_cameraRevision;
+
+		int m_drawnNodes;
+		int m_culledNodes;
+};
+
+#endif
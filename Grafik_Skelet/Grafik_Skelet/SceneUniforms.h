@@ -0,0 +1,63 @@
+/** @file
+* The std140 uniform blocks with the material and light parameters of Shader.vert and Shader.frag.
+*/
+
+#ifndef SCENE_UNIFORMS_H
+#define SCENE_UNIFORMS_H
+
+#include "glmutils.h"
+
+// Uniform buffer binding points of the blocks, shared by all programs
+const unsigned int MATERIAL_BLOCK_BINDING = 0;
+const unsigned int LIGHT_BLOCK_BINDING = 1;
+const unsigned int INSTANCE_MATERIAL_BLOCK_BINDING = 2;
+
+/**
+* layout(std140) uniform Material. In std140 a vec3 is aligned to 16 bytes,
+* and a following float is packed into its fourth component.
+*/
+struct MaterialBlock
+{
+	// The padding is zeroed too, since UniformBuffer compares the whole block
+	MaterialBlock() : ambient(0.0f), pad0(0.0f), diffuse(0.0f), pad1(0.0f), specular(0.0f), shiny(0.0f) {}
+
+	glm::vec3 ambient;  float pad0;
+	glm::vec3 diffuse;  float pad1;
+	glm::vec3 specular; float shiny;
+};
+
+// Size of the lights array in the Light block, injected as MAX_LIGHTS into the shaders
+const int MAX_LIGHTS = 4;
+
+// struct LightSource, the elements of the array in the Light block
+struct LightSource
+{
+	LightSource() : position(0.0f), intensity(0.0f), pad0(0.0f), ambient(0.0f), pad1(0.0f),
+					diffuse(0.0f), pad2(0.0f), specular(0.0f), pad3(0.0f) {}
+
+	glm::vec4 position;
+	glm::vec3 intensity; float pad0;
+	glm::vec3 ambient;   float pad1;
+	glm::vec3 diffuse;   float pad2;
+	glm::vec3 specular;  float pad3;
+};
+
+// layout(std140) uniform Light, only the first NUM_LIGHTS lights are used by a shader variant
+struct LightBlock
+{
+	LightSource lights[MAX_LIGHTS];
+};
+
+// Size of the array in the InstanceMaterials block, injected as MAX_INSTANCE_MATERIALS into the shaders
+const int MAX_INSTANCE_MATERIALS = 16;
+
+// layout(std140) uniform InstanceMaterials, the elements of the array have the layout of the Material block
+struct InstanceMaterialBlock
+{
+	MaterialBlock materials[MAX_INSTANCE_MATERIALS];
+};
+
+static_assert(sizeof(MaterialBlock) == 48, "MaterialBlock does not match the std140 layout");
+static_assert(sizeof(LightSource) == 80, "LightSource does not match the std140 layout");
+
+#endif
@@ -1,46 +1,103 @@
 #version 330
 
+// See Shader.vert for the #defines which select the variant
+#ifndef MAX_LIGHTS
+#define MAX_LIGHTS 4
+#endif
+#ifndef NUM_LIGHTS
+#define NUM_LIGHTS 1
+#endif
+#ifndef MAX_INSTANCE_MATERIALS
+#define MAX_INSTANCE_MATERIALS 16
+#endif
+
 layout(location = 0) out vec4 colourOut;
 
-// Light variables
-uniform vec4 lightPos;
-uniform vec3 lightIntensity;
-uniform vec3 lightAmbient;
-uniform vec3 lightDiffuse;
-uniform vec3 lightSpecular;
+// Light variables, shared by all programs through a uniform buffer
+struct LightSource {
+	vec4 lightPos;
+	vec3 lightIntensity;
+	vec3 lightAmbient;
+	vec3 lightDiffuse;
+	vec3 lightSpecular;
+};
+
+layout(std140) uniform Light {
+	LightSource lights[MAX_LIGHTS];
+};
+
+#ifdef INSTANCED
+// The materials of the instances, the index is set per instance by Shader.vert
+struct MaterialData {
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+	float shiny;
+};
+
+layout(std140) uniform InstanceMaterials {
+	MaterialData instanceMaterials[MAX_INSTANCE_MATERIALS];
+};
+
+flat in int materialIndex;
 
-// Material variables
-uniform vec3 matAmbient;
-uniform vec3 matDiffuse;
-uniform vec3 matSpecular;
-uniform float matShiny;
+#define matAmbient instanceMaterials[materialIndex].ambient
+#define matDiffuse instanceMaterials[materialIndex].diffuse
+#define matSpecular instanceMaterials[materialIndex].specular
+#define matShiny instanceMaterials[materialIndex].shiny
+#else
+// Material variables, shared by all programs through a uniform buffer
+layout(std140) uniform Material {
+	vec3 matAmbient;
+	vec3 matDiffuse;
+	vec3 matSpecular;
+	float matShiny;
+};
+#endif
 
-// Matrices
+// Matrices, uModelMatrix transforms the vertices to eye coordinates, and
+// viewMatrix the lights, which are in world coordinates
 uniform mat4 uModelMatrix;
 uniform mat3 normalvectorMatrix;
 uniform mat4 projectionMatrix;
+uniform mat4 viewMatrix;
 
+#ifdef LIGHTING_PER_VERTEX
+in vec3 frontColour;
+in vec3 backColour;
+#else
 in vec4 curVert;
 in vec3 curNormalVec;
 
 // Function for Phong's Reflection Model 
 vec3 phongReflection() {
-	vec4 lightPosTransformation = uModelMatrix * lightPos;
   // Invert the normals depending on the camera facing
 	vec3 n = gl_FrontFacing ? -normalize ( curNormalVec ) : normalize ( curNormalVec );
-	vec3 s = normalize( vec3(lightPosTransformation - curVert) );
 	vec3 v = normalize( vec3(-curVert) );
-	vec3 r = reflect( -s, n );
   vec3 matDiffuseNew = matDiffuse;
+#ifdef BACK_FACE_COLORING
   // Make different colors for the front- and backplane
-  matDiffuseNew  = gl_FrontFacing ?  matDiffuse : (glm::vec3(1.0, 1.0, 1.0) - matDiffuse); 
-	return (matAmbient * lightAmbient + 
-	        matDiffuseNew * lightDiffuse * max( dot(s,n), 0.0 ) +
-			    matSpecular * lightSpecular * pow(max(dot(r,v), 0.0), matShiny));
+  matDiffuseNew  = gl_FrontFacing ?  matDiffuse : (vec3(1.0, 1.0, 1.0) - matDiffuse); 
+#endif
+	vec3 colour = vec3(0.0);
+	for (int i = 0; i < NUM_LIGHTS; i++) {
+		vec4 lightPosTransformation = viewMatrix * lights[i].lightPos;
+		vec3 s = normalize( vec3(lightPosTransformation - curVert) );
+		vec3 r = reflect( -s, n );
+		colour += matAmbient * lights[i].lightAmbient + 
+		          matDiffuseNew * lights[i].lightDiffuse * max( dot(s,n), 0.0 ) +
+		          matSpecular * lights[i].lightSpecular * pow(max(dot(r,v), 0.0), matShiny);
+	}
+	return colour;
 }
+#endif
 
 void main() {
+#ifdef LIGHTING_PER_VERTEX
+   colourOut = vec4(gl_FrontFacing ? frontColour : backColour, 1.0);
+#else
    colourOut = vec4(phongReflection(), 1.0);
+#endif
    //colourOut = vec4(1.0, 0.0, 0.0, 1.0);
 
 
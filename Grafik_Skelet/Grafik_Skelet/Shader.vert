@@ -1,36 +1,133 @@
 #version 330
 
+// Variants are selected with #defines injected by ShaderProgram:
+// LIGHTING_PER_VERTEX - Phong's reflection model is evaluated per vertex (Gouraud shading)
+// NUM_LIGHTS          - number of the lights in the Light block which are used
+// BACK_FACE_COLORING  - back faces get the complementary diffuse color
+// INSTANCED           - every instance has its own model matrix and material, see InstancedMesh and MeshBuffer
+#ifndef MAX_LIGHTS
+#define MAX_LIGHTS 4
+#endif
+#ifndef NUM_LIGHTS
+#define NUM_LIGHTS 1
+#endif
+#ifndef MAX_INSTANCE_MATERIALS
+#define MAX_INSTANCE_MATERIALS 16
+#endif
+
 layout(location = 0) in vec3 vertPosition;
 layout(location = 1) in vec3 vertReflect;
 
-// Light variables
-uniform vec4 lightPos;
-uniform vec3 lightIntensity;
-uniform vec3 lightAmbient;
-uniform vec3 lightDiffuse;
-uniform vec3 lightSpecular;
+#ifdef INSTANCED
+// Per instance attributes, the matrices take one location per column. The normal
+// matrix of the transform is computed once per instance on the CPU
+layout(location = 2) in mat4 instanceTransform;
+layout(location = 6) in int instanceMaterial;
+layout(location = 7) in mat3 instanceNormalMatrix;
+#endif
+
+// Light variables, shared by all programs through a uniform buffer
+struct LightSource {
+	vec4 lightPos;
+	vec3 lightIntensity;
+	vec3 lightAmbient;
+	vec3 lightDiffuse;
+	vec3 lightSpecular;
+};
+
+layout(std140) uniform Light {
+	LightSource lights[MAX_LIGHTS];
+};
+
+#ifdef INSTANCED
+// The materials of the instances, shared by all instanced programs through a uniform buffer
+struct MaterialData {
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+	float shiny;
+};
+
+layout(std140) uniform InstanceMaterials {
+	MaterialData instanceMaterials[MAX_INSTANCE_MATERIALS];
+};
+
+// Passed on to Shader.frag, which has no per instance attributes
+flat out int materialIndex;
 
-// Material variables
-uniform vec3 matAmbient;
-uniform vec3 matDiffuse;
-uniform vec3 matSpecular;
-uniform float matShiny;
+#define matAmbient instanceMaterials[instanceMaterial].ambient
+#define matDiffuse instanceMaterials[instanceMaterial].diffuse
+#define matSpecular instanceMaterials[instanceMaterial].specular
+#define matShiny instanceMaterials[instanceMaterial].shiny
+#else
+// Material variables, shared by all programs through a uniform buffer
+layout(std140) uniform Material {
+	vec3 matAmbient;
+	vec3 matDiffuse;
+	vec3 matSpecular;
+	float matShiny;
+};
+#endif
 
-// Matrices
+// Matrices, uModelMatrix transforms the vertices to eye coordinates, and
+// viewMatrix the lights, which are in world coordinates
 uniform mat4 uModelMatrix;
 uniform mat3 normalvectorMatrix;
 uniform mat4 projectionMatrix;
+uniform mat4 viewMatrix;
 
+#ifdef LIGHTING_PER_VERTEX
+// Both sides are lit here, the fragment shader picks the side with gl_FrontFacing
+out vec3 frontColour;
+out vec3 backColour;
+
+// Function for Phong's Reflection Model, n is the normal of the lit side
+vec3 phongReflection(vec4 vert, vec3 n, vec3 diffuse) {
+	vec3 v = normalize( vec3(-vert) );
+	vec3 colour = vec3(0.0);
+	for (int i = 0; i < NUM_LIGHTS; i++) {
+		vec4 lightPosTransformation = viewMatrix * lights[i].lightPos;
+		vec3 s = normalize( vec3(lightPosTransformation - vert) );
+		vec3 r = reflect( -s, n );
+		colour += matAmbient * lights[i].lightAmbient +
+		          diffuse * lights[i].lightDiffuse * max( dot(s,n), 0.0 ) +
+		          matSpecular * lights[i].lightSpecular * pow(max(dot(r,v), 0.0), matShiny);
+	}
+	return colour;
+}
+#else
 out vec4 curVert;
 out vec3 curNormalVec;
+#endif
 
 void main() {
+#ifdef INSTANCED
+    // The instance is transformed to world coordinates before the camera transformation
+    mat4 modelView = uModelMatrix * instanceTransform;
+    mat3 normalMatrix = normalvectorMatrix * instanceNormalMatrix;
+    materialIndex = instanceMaterial;
+#else
+    mat4 modelView = uModelMatrix;
+    mat3 normalMatrix = normalvectorMatrix;
+#endif
+
     // Compute position of the current vertex
-    curVert = uModelMatrix * vec4(vertPosition, 1.0f);
+    vec4 vert = modelView * vec4(vertPosition, 1.0f);
     // Compute the current normal vector
-    curNormalVec = normalize(normalvectorMatrix * vertReflect);
-
-    gl_Position = projectionMatrix * uModelMatrix * vec4(vertPosition.xyz, 1.0);
-}
+    vec3 normalVec = normalize(normalMatrix * vertReflect);
 
+#ifdef LIGHTING_PER_VERTEX
+    // Same sides and colors as the per fragment lighting in Shader.frag
+    frontColour = phongReflection(vert, -normalVec, matDiffuse);
+  #ifdef BACK_FACE_COLORING
+    backColour = phongReflection(vert, normalVec, vec3(1.0, 1.0, 1.0) - matDiffuse);
+  #else
+    backColour = phongReflection(vert, normalVec, matDiffuse);
+  #endif
+#else
+    curVert = vert;
+    curNormalVec = normalVec;
+#endif
 
+    gl_Position = projectionMatrix * vert;
+}
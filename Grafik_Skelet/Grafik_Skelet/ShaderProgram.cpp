@@ -8,8 +8,11 @@
 #include "ShaderProgram.h"
 
 #include <stdarg.h>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <sstream>
 using std::ifstream;
 
 /**
@@ -30,14 +33,40 @@ static int filePrint(std::string const& filename, char const* msg, ...)
 
 	vfprintf(pFile, msg, ap);
 	va_end(ap);
+	fclose(pFile);
 	return 0;
 }
 
 std::vector<ShaderProgram*> ShaderProgram::s_programs;
+std::map<std::string, GLuint> ShaderProgram::s_blockBindings;
+std::string ShaderProgram::s_binaryCacheDirectory = ".";
+std::map<std::string, GLuint> ShaderProgram::s_variants;
+
+// Identifies the cache files and the layout of their header
+static const unsigned int BINARY_CACHE_MAGIC = 0x42505347; // "GSPB"
+
+// 64-bit FNV-1a hash, continued from the given hash
+static unsigned long long fnv1a(std::string const& data, unsigned long long hash)
+{
+	for(std::string::size_type i = 0; i < data.size(); i++) {
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static std::string glString(GLenum name)
+{
+	GLubyte const* str = glGetString(name);
+	return str != NULL ? std::string((char const*)str) : std::string();
+}
 
 ShaderProgram::ShaderProgram()
 {
 	m_program = 0;
+	m_status = LINKED;
+	m_vertexShader = 0;
+	m_fragmentShader = 0;
 }
 
 ShaderProgram::~ShaderProgram()
@@ -62,6 +91,172 @@ void ShaderProgram::deleteShaderPrograms()
 		delete *it;
 
 	s_programs.clear();
+	s_variants.clear();
+}
+
+GLuint ShaderProgram::compileShaderProgram(std::string const& vs, std::string const& fs,
+										   std::vector<std::string> const& defines)
+{
+	std::string variantVs = injectDefines(vs, defines);
+	std::string variantFs = injectDefines(fs, defines);
+
+	std::string key = variantVs + '\0' + variantFs;
+	std::map<std::string, GLuint>::const_iterator variant = s_variants.find(key);
+	if(variant != s_variants.end())
+		return variant->second;
+
+	GLuint program = compileShaderProgram(variantVs, variantFs);
+	s_variants[key] = program;
+	return program;
+}
+
+std::string ShaderProgram::injectDefines(std::string const& source, std::vector<std::string> const& defines)
+{
+	// The #version directive must stay the first line of the shader
+	std::string::size_type start = 0;
+	std::string::size_type version = source.find("#version");
+	if(version != std::string::npos) {
+		start = source.find('\n', version);
+		start = (start == std::string::npos) ? source.size() : start + 1;
+	}
+
+	// Keep the line numbers of the compile errors the same as in the file
+	int line = 1;
+	for(std::string::size_type i = 0; i < start; i++) {
+		if(source[i] == '\n')
+			line++;
+	}
+
+	std::string result = source.substr(0, start);
+	if(version != std::string::npos && source[start - 1] != '\n') {
+		result += '\n';
+		line++;
+	}
+	for(std::vector<std::string>::const_iterator it = defines.begin(); it != defines.end(); ++it)
+		result += "#define " + *it + "\n";
+
+	std::ostringstream directive;
+	directive << "#line " << line << "\n";
+	result += directive.str();
+
+	result += source.substr(start);
+	return result;
+}
+
+GLint ShaderProgram::uniformLocation(GLuint program, std::string const& name)
+{
+	for(std::vector<ShaderProgram*>::iterator it = s_programs.begin(); it != s_programs.end(); ++it)
+	{
+		if((*it)->m_program == program) {
+			std::map<std::string, GLint>::const_iterator uniform = (*it)->m_uniforms.find(name);
+			return uniform != (*it)->m_uniforms.end() ? uniform->second : -1;
+		}
+	}
+	return -1;
+}
+
+void ShaderProgram::setUniformBlockBinding(std::string const& blockName, GLuint binding)
+{
+	s_blockBindings[blockName] = binding;
+
+	for(std::vector<ShaderProgram*>::iterator it = s_programs.begin(); it != s_programs.end(); ++it)
+		(*it)->bindUniformBlocks();
+}
+
+void ShaderProgram::setBinaryCacheDirectory(std::string const& directory)
+{
+	s_binaryCacheDirectory = directory;
+}
+
+bool ShaderProgram::binaryCacheSupported()
+{
+	if(s_binaryCacheDirectory.empty() || !(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary))
+		return false;
+
+	GLint numFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+	return numFormats > 0;
+}
+
+std::string ShaderProgram::binaryCacheFile(std::string const& vs, std::string const& fs)
+{
+	// A binary is only valid for the same sources on the same driver
+	unsigned long long hash = 14695981039346656037ULL;
+	hash = fnv1a(vs, hash);
+	hash = fnv1a(std::string(1, '\0'), hash);
+	hash = fnv1a(fs, hash);
+	hash = fnv1a(glString(GL_VENDOR), hash);
+	hash = fnv1a(glString(GL_RENDERER), hash);
+	hash = fnv1a(glString(GL_VERSION), hash);
+
+	std::ostringstream filename;
+	filename << s_binaryCacheDirectory << "/shader_" << std::hex;
+	filename.width(16);
+	filename.fill('0');
+	filename << hash << ".bin";
+	return filename.str();
+}
+
+bool ShaderProgram::loadBinary(std::string const& filename)
+{
+	ifstream ifs(filename.data(), std::ios::binary);
+	if(!ifs.is_open())
+		return false;
+
+	unsigned int header[3] = { 0 }; // magic, format, length
+	ifs.read((char*)header, sizeof(header));
+	if(!ifs || header[0] != BINARY_CACHE_MAGIC || header[2] == 0)
+		return false;
+
+	// The length comes from the file, so it is checked against the bytes which follow the
+	// header before anything is allocated. saveBinary() writes exactly that many
+	std::streamoff start = ifs.tellg();
+	ifs.seekg(0, std::ios::end);
+	std::streamoff remaining = ifs.tellg() - start;
+	if(start < 0 || remaining != (std::streamoff)header[2])
+		return false;
+	ifs.seekg(start);
+
+	std::vector<char> binary(header[2]);
+	ifs.read(&binary[0], binary.size());
+	if(!ifs)
+		return false;
+
+	// The driver refuses binaries it cannot use, e.g. after a driver update
+	glProgramBinary(m_program, (GLenum)header[1], &binary[0], (GLsizei)binary.size());
+	GLint success = 0;
+	glGetProgramiv(m_program, GL_LINK_STATUS, &success);
+	return success != 0;
+}
+
+void ShaderProgram::saveBinary(std::string const& filename)
+{
+	GLint length = 0;
+	glGetProgramiv(m_program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if(length <= 0)
+		return;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(m_program, length, &length, &format, &binary[0]);
+
+	// Written to a temporary file first, so a crash never leaves a truncated binary
+	std::string temporary = filename + ".tmp";
+	std::ofstream ofs(temporary.data(), std::ios::binary | std::ios::trunc);
+	if(!ofs.is_open())
+		return;
+
+	unsigned int header[3] = { BINARY_CACHE_MAGIC, (unsigned int)format, (unsigned int)length };
+	ofs.write((char const*)header, sizeof(header));
+	ofs.write(&binary[0], length);
+	ofs.close();
+
+	if(!ofs) {
+		remove(temporary.data());
+		return;
+	}
+	remove(filename.data());
+	rename(temporary.data(), filename.data());
 }
 
 GLuint ShaderProgram::getProgram()
@@ -69,6 +264,54 @@ GLuint ShaderProgram::getProgram()
 	return m_program;
 }
 
+void ShaderProgram::readUniforms()
+{
+	m_uniforms.clear();
+
+	GLint count = 0;
+	GLint maxLength = 0;
+	glGetProgramiv(m_program, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(m_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	std::vector<GLchar> name(maxLength + 1);
+	for(GLint i = 0; i < count; i++)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(m_program, i, (GLsizei)name.size(), &length, &size, &type, &name[0]);
+
+		// Uniforms in uniform blocks have no location
+		std::string uniformName(&name[0], length);
+		GLint location = glGetUniformLocation(m_program, uniformName.c_str());
+		if(location < 0)
+			continue;
+
+		m_uniforms[uniformName] = location;
+		// Arrays are reported as "name[0]", make them available as "name" too
+		std::string::size_type bracket = uniformName.find('[');
+		if(bracket != std::string::npos)
+			m_uniforms[uniformName.substr(0, bracket)] = location;
+	}
+}
+
+void ShaderProgram::bindUniformBlocks()
+{
+	GLint count = 0;
+	glGetProgramiv(m_program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+
+	for(GLint i = 0; i < count; i++)
+	{
+		GLchar name[256] = { 0 };
+		GLsizei length = 0;
+		glGetActiveUniformBlockName(m_program, i, sizeof(name), &length, name);
+
+		std::map<std::string, GLuint>::const_iterator binding = s_blockBindings.find(std::string(name, length));
+		if(binding != s_blockBindings.end())
+			glUniformBlockBinding(m_program, i, binding->second);
+	}
+}
+
 void ShaderProgram::compileShader(std::string const& vs, std::string const& fs)
 {
 	if(m_program != 0) {
@@ -82,12 +325,22 @@ void ShaderProgram::compileShader(std::string const& vs, std::string const& fs)
 		filePrint("error.txt", "Fatal: Error creating shader program.\n");
 		exit(EXIT_FAILURE);
 	}
+
+	bool useCache = binaryCacheSupported();
+	std::string cacheFile = useCache ? binaryCacheFile(vs, fs) : std::string();
+	if(useCache && loadBinary(cacheFile)) {
+		readUniforms();
+		bindUniformBlocks();
+		return;
+	}
 	
 	addShader(vs, GL_VERTEX_SHADER);
 	addShader(fs, GL_FRAGMENT_SHADER);
 	
 	GLint success;
 
+	if(useCache)
+		glProgramParameteri(m_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(m_program);
 	glGetProgramiv(m_program, GL_LINK_STATUS, &success);
 	if(success == 0) {
@@ -96,6 +349,9 @@ void ShaderProgram::compileShader(std::string const& vs, std::string const& fs)
 		filePrint("error.txt", "Fatal: Error linking shader program: %s\n", errorLog);
 		exit(EXIT_FAILURE);
 	}
+
+	readUniforms();
+	bindUniformBlocks();
 	
 	glValidateProgram(m_program);
 	glGetProgramiv(m_program, GL_VALIDATE_STATUS, &success);
@@ -105,9 +361,28 @@ void ShaderProgram::compileShader(std::string const& vs, std::string const& fs)
 		filePrint("error.txt", "Fatal: Invalid shader program: %s\n", errorLog);
 		exit(EXIT_FAILURE);
 	}
+
+	if(useCache)
+		saveBinary(cacheFile);
 }
 
 void ShaderProgram::addShader(std::string const& shaderString, GLenum shaderType)
+{
+	GLuint shaderObj = createShader(shaderString, shaderType);
+
+	GLint success;
+	glGetShaderiv(shaderObj, GL_COMPILE_STATUS, &success);
+	if(!success) {
+		GLchar errorLog[1024] = { 0 };
+		glGetShaderInfoLog(shaderObj, 1024, NULL, errorLog);
+		filePrint("error.txt", "Fatal: Error compiling shader type %d: %s\n", shaderType, errorLog);
+		exit(EXIT_FAILURE);
+	}
+
+	glAttachShader(m_program, shaderObj);
+}
+
+GLuint ShaderProgram::createShader(std::string const& shaderString, GLenum shaderType)
 {
 	GLuint shaderObj = glCreateShader(shaderType);
 	if(shaderObj == 0) {
@@ -120,14 +395,163 @@ void ShaderProgram::addShader(std::string const& shaderString, GLenum shaderType
 	glShaderSource(shaderObj, 1, &str, &length);
 	glCompileShader(shaderObj);
 
-	GLint success;
-	glGetShaderiv(shaderObj, GL_COMPILE_STATUS, &success);
-	if(!success) {
-		GLchar errorLog[1024] = { 0 };
-		glGetShaderInfoLog(shaderObj, 1024, NULL, errorLog);
-		filePrint("error.txt", "Fatal: Error compiling shader type %d: %s\n", shaderType, errorLog);
+	return shaderObj;
+}
+
+// Not in GLEW yet, the values are from the KHR_parallel_shader_compile specification
+#ifndef GL_COMPLETION_STATUS_KHR
+	#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+bool ShaderProgram::parallelCompileSupported()
+{
+	// The default number of compiler threads is chosen by the driver, so only
+	// the completion status of the extension is used
+	static int supported = -1;
+	if(supported < 0) {
+		supported = 0;
+		GLint numExtensions = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+		for(GLint i = 0; i < numExtensions && supported == 0; i++)
+		{
+			char const* name = (char const*)glGetStringi(GL_EXTENSIONS, i);
+			if(name != NULL && (strcmp(name, "GL_KHR_parallel_shader_compile") == 0 ||
+								strcmp(name, "GL_ARB_parallel_shader_compile") == 0))
+				supported = 1;
+		}
+	}
+	return supported == 1;
+}
+
+ShaderProgram* ShaderProgram::findProgram(GLuint program)
+{
+	for(std::vector<ShaderProgram*>::iterator it = s_programs.begin(); it != s_programs.end(); ++it)
+	{
+		if((*it)->m_program == program)
+			return *it;
+	}
+	return NULL;
+}
+
+GLuint ShaderProgram::compileShaderProgramAsync(std::string const& vs, std::string const& fs)
+{
+	ShaderProgram* program = new ShaderProgram();
+	program->startCompile(vs, fs);
+
+	s_programs.push_back(program);
+
+	return program->getProgram();
+}
+
+int ShaderProgram::pollShaderProgram(GLuint program)
+{
+	ShaderProgram* shaderProgram = findProgram(program);
+	if(shaderProgram == NULL)
+		return -1;
+
+	if(shaderProgram->m_status == LINKING) {
+		if(parallelCompileSupported()) {
+			GLint completed = GL_FALSE;
+			glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &completed);
+			if(completed == GL_FALSE)
+				return 0;
+		}
+		if(!shaderProgram->finishCompile()) {
+			deleteShaderProgram(program);
+			return -1;
+		}
+	}
+	return shaderProgram->m_status == LINKED ? 1 : -1;
+}
+
+void ShaderProgram::deleteShaderProgram(GLuint program)
+{
+	for(std::vector<ShaderProgram*>::iterator it = s_programs.begin(); it != s_programs.end(); ++it)
+	{
+		if((*it)->m_program == program) {
+			delete *it;
+			s_programs.erase(it);
+			break;
+		}
+	}
+
+	for(std::map<std::string, GLuint>::iterator it = s_variants.begin(); it != s_variants.end(); )
+	{
+		if(it->second == program)
+			s_variants.erase(it++);
+		else
+			++it;
+	}
+}
+
+void ShaderProgram::startCompile(std::string const& vs, std::string const& fs)
+{
+	m_program = glCreateProgram();
+	if(m_program == 0) {
+		filePrint("error.txt", "Fatal: Error creating shader program.\n");
 		exit(EXIT_FAILURE);
 	}
 
-	glAttachShader(m_program, shaderObj);
+	bool useCache = binaryCacheSupported();
+	m_cacheFile = useCache ? binaryCacheFile(vs, fs) : std::string();
+	if(useCache && loadBinary(m_cacheFile)) {
+		readUniforms();
+		bindUniformBlocks();
+		m_status = LINKED;
+		return;
+	}
+
+	// No status is queried here, since that would wait for the compiler
+	m_vertexShader = createShader(vs, GL_VERTEX_SHADER);
+	m_fragmentShader = createShader(fs, GL_FRAGMENT_SHADER);
+	glAttachShader(m_program, m_vertexShader);
+	glAttachShader(m_program, m_fragmentShader);
+
+	if(useCache)
+		glProgramParameteri(m_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(m_program);
+	m_status = LINKING;
+}
+
+bool ShaderProgram::finishCompile()
+{
+	GLint success = 0;
+	glGetProgramiv(m_program, GL_LINK_STATUS, &success);
+
+	if(success == 0) {
+		GLuint shaders[2] = { m_vertexShader, m_fragmentShader };
+		for(int i = 0; i < 2; i++)
+		{
+			GLint compiled = 0;
+			glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &compiled);
+			if(!compiled) {
+				GLchar errorLog[1024] = { 0 };
+				glGetShaderInfoLog(shaders[i], 1024, NULL, errorLog);
+				GLint shaderType = 0;
+				glGetShaderiv(shaders[i], GL_SHADER_TYPE, &shaderType);
+				filePrint("error.txt", "Error compiling shader type %d: %s\n", shaderType, errorLog);
+			}
+		}
+		GLchar errorLog[1024] = { 0 };
+		glGetProgramInfoLog(m_program, 1024, NULL, errorLog);
+		filePrint("error.txt", "Error linking shader program: %s\n", errorLog);
+	}
+
+	glDetachShader(m_program, m_vertexShader);
+	glDetachShader(m_program, m_fragmentShader);
+	glDeleteShader(m_vertexShader);
+	glDeleteShader(m_fragmentShader);
+	m_vertexShader = m_fragmentShader = 0;
+
+	if(success == 0) {
+		m_status = FAILED;
+		return false;
+	}
+
+	readUniforms();
+	bindUniformBlocks();
+	if(!m_cacheFile.empty())
+		saveBinary(m_cacheFile);
+	m_status = LINKED;
+	return true;
 }
@@ -25,6 +25,7 @@
 
 #include <string>
 #include <vector>
+#include <map>
 
 class ShaderProgram
 {
@@ -39,16 +40,86 @@ class ShaderProgram
 		static GLuint compileShaderProgram(std::string const& vs, std::string const& fs);
 		static void deleteShaderPrograms();
 
+		/**
+		* Compiles a variant of a program, with a line "#define <define>" for each of the
+		* defines inserted after the #version line of both shaders, e.g. "NUM_LIGHTS 2".
+		* Every variant is only compiled once, later calls return the same program.
+		*/
+		static GLuint compileShaderProgram(std::string const& vs, std::string const& fs,
+										   std::vector<std::string> const& defines);
+
+		/**
+		* Returns the location of a uniform of a program, or -1 if it is not an active uniform.
+		* The locations are read once when the program is linked, so no driver call is made.
+		*/
+		static GLint uniformLocation(GLuint program, std::string const& name);
+
+		/**
+		* Binds the uniform block with the given name to a uniform buffer binding point,
+		* in all programs that are already compiled and in the programs compiled later.
+		*/
+		static void setUniformBlockBinding(std::string const& blockName, GLuint binding);
+
+		/**
+		* Directory for the cache of linked program binaries, an empty string disables the cache.
+		* Programs are loaded from the cache when the sources and the driver are unchanged,
+		* and compiled from the sources otherwise. The directory must exist.
+		*/
+		static void setBinaryCacheDirectory(std::string const& directory);
+
+		/**
+		* Starts compiling and linking a program without waiting for the result.
+		* With KHR_parallel_shader_compile the driver works on its own threads,
+		* otherwise the work is finished at the latest by pollShaderProgram().
+		*/
+		static GLuint compileShaderProgramAsync(std::string const& vs, std::string const& fs);
+
+		/**
+		* Returns 0 while the program is being compiled, 1 when it has linked and -1 if it failed.
+		* Unlike compileShaderProgram() errors are not fatal, they are written to error.txt
+		* and the program is deleted.
+		*/
+		static int pollShaderProgram(GLuint program);
+
+		static void deleteShaderProgram(GLuint program);
+
+		static std::string injectDefines(std::string const& source, std::vector<std::string> const& defines);
+
 	private:
 		GLuint getProgram();
 
 		void compileShader(std::string const& vs, std::string const& fs);
 		void addShader(std::string const& shaderString, GLenum shaderType);
+		GLuint createShader(std::string const& shaderString, GLenum shaderType);
+
+		void startCompile(std::string const& vs, std::string const& fs);
+		bool finishCompile();
+		static bool parallelCompileSupported();
+		static ShaderProgram* findProgram(GLuint program);
+
+		void readUniforms();
+		void bindUniformBlocks();
+
+		static bool binaryCacheSupported();
+		static std::string binaryCacheFile(std::string const& vs, std::string const& fs);
+		bool loadBinary(std::string const& filename);
+		void saveBinary(std::string const& filename);
 
 	private:
 		GLuint m_program;
+		std::map<std::string, GLint> m_uniforms;
+
+		// State of a program compiled with compileShaderProgramAsync()
+		enum Status { LINKING, LINKED, FAILED };
+		Status m_status;
+		GLuint m_vertexShader;
+		GLuint m_fragmentShader;
+		std::string m_cacheFile;
 
 		static std::vector<ShaderProgram*> s_programs;
+		static std::map<std::string, GLuint> s_blockBindings;
+		static std::string s_binaryCacheDirectory;
+		static std::map<std::string, GLuint> s_variants;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,165 @@
+/** @file
+* Loads the variants of a shader program from files, compiles them in the
+* background and reloads them when the files change.
+*/
+
+#include "ShaderReloader.h"
+
+#include <sys/stat.h>
+#include <fstream>
+
+#include "ShaderProgram.h"
+
+static time_t modificationTime(std::string const& filename)
+{
+	struct stat info;
+	if(stat(filename.data(), &info) != 0)
+		return 0;
+	return info.st_mtime;
+}
+
+static bool readFile(std::string const& filename, std::string* result)
+{
+	std::ifstream ifs(filename.data());
+	if(!ifs.is_open())
+		return false;
+	*result = std::string((std::istreambuf_iterator<char>(ifs)),
+						  (std::istreambuf_iterator<char>()));
+	return true;
+}
+
+ShaderReloader::ShaderReloader(std::string const& vsFile, std::string const& fsFile)
+{
+	m_vsFile = vsFile;
+	m_fsFile = fsFile;
+	m_linked = false;
+
+	m_vsTime = modificationTime(m_vsFile);
+	m_fsTime = modificationTime(m_fsFile);
+	m_loaded = readSources();
+}
+
+ShaderReloader::~ShaderReloader()
+{
+}
+
+bool ShaderReloader::sourcesLoaded() const
+{
+	return m_loaded;
+}
+
+bool ShaderReloader::readSources()
+{
+	std::string vs, fs;
+	if(!readFile(m_vsFile, &vs) || !readFile(m_fsFile, &fs))
+		return false;
+	m_vs = vs;
+	m_fs = fs;
+	return true;
+}
+
+GLuint ShaderReloader::program(std::vector<std::string> const& defines, std::string const& family)
+{
+	std::string key;
+	for(std::vector<std::string>::const_iterator it = defines.begin(); it != defines.end(); ++it)
+		key += *it + "\n";
+
+	std::map<std::string, Variant>::iterator found = m_variants.find(key);
+	if(found == m_variants.end()) {
+		Variant variant;
+		variant.defines = defines;
+		variant.current = 0;
+		variant.pending = 0;
+		found = m_variants.insert(std::make_pair(key, variant)).first;
+		startCompile(found->second);
+	}
+
+	Variant& variant = found->second;
+	if(variant.pending != 0) {
+		if(variant.current == 0 && !m_linked) {
+			// Nothing has been drawn yet, so wait for the first program
+			while(variant.pending != 0 && !finishCompile(variant)) {}
+		}
+		else {
+			finishCompile(variant);
+		}
+	}
+
+	if(variant.current != 0) {
+		m_linked = true;
+		if(!family.empty())
+			m_families[family] = key;
+		return variant.current;
+	}
+
+	// Only the variants of the same family are interchangeable. Their current program
+	// is only deleted when a newer one replaces it, so it is never a stale name
+	std::map<std::string, std::string>::const_iterator last = m_families.find(family);
+	if(family.empty() || last == m_families.end())
+		return 0;
+	return m_variants[last->second].current;
+}
+
+bool ShaderReloader::update(bool checkFiles)
+{
+	time_t vsTime = checkFiles ? modificationTime(m_vsFile) : m_vsTime;
+	time_t fsTime = checkFiles ? modificationTime(m_fsFile) : m_fsTime;
+	if(vsTime != m_vsTime || fsTime != m_fsTime) {
+		m_vsTime = vsTime;
+		m_fsTime = fsTime;
+		// Editors may write the file in several steps, it is read again on the next change
+		if(readSources()) {
+			for(std::map<std::string, Variant>::iterator it = m_variants.begin(); it != m_variants.end(); ++it)
+				startCompile(it->second);
+		}
+	}
+
+	bool replaced = false;
+	for(std::map<std::string, Variant>::iterator it = m_variants.begin(); it != m_variants.end(); ++it)
+	{
+		if(it->second.pending != 0 && finishCompile(it->second))
+			replaced = true;
+	}
+	return replaced;
+}
+
+bool ShaderReloader::compiling() const
+{
+	for(std::map<std::string, Variant>::const_iterator it = m_variants.begin(); it != m_variants.end(); ++it)
+	{
+		if(it->second.pending != 0)
+			return true;
+	}
+	return false;
+}
+
+void ShaderReloader::startCompile(Variant& variant)
+{
+	// A newer version replaces a compilation which has not finished yet
+	if(variant.pending != 0)
+		ShaderProgram::deleteShaderProgram(variant.pending);
+
+	variant.pending = ShaderProgram::compileShaderProgramAsync(
+		ShaderProgram::injectDefines(m_vs, variant.defines),
+		ShaderProgram::injectDefines(m_fs, variant.defines));
+}
+
+bool ShaderReloader::finishCompile(Variant& variant)
+{
+	int status = ShaderProgram::pollShaderProgram(variant.pending);
+	if(status == 0)
+		return false;
+
+	if(status < 0) {
+		// The error is in error.txt, the previous version is kept
+		variant.pending = 0;
+		return false;
+	}
+
+	GLuint previous = variant.current;
+	variant.current = variant.pending;
+	variant.pending = 0;
+	if(previous != 0)
+		ShaderProgram::deleteShaderProgram(previous);
+	return true;
+}
@@ -0,0 +1,89 @@
+/** @file
+* Loads the variants of a shader program from files, compiles them in the
+* background and reloads them when the files change.
+*/
+
+#ifndef SHADER_RELOADER_H
+#define SHADER_RELOADER_H
+
+#if defined(WIN32) || defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#endif
+
+#if defined(__APPLE__) && defined(__MACH__)
+	#include <OpenGL/glew.h>
+	#include <OpenGL/gl.h>
+	#include <OpenGL/glu.h>
+#else
+	#include <GL/glew.h>
+	#include <GL/gl.h>
+	#include <GL/glu.h>
+#endif
+
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+* Every variant (set of #defines) keeps the program it was last linked with
+* until a newer compilation of it has linked, so editing a shader never
+* stalls the rendering, and a shader with errors is reported in error.txt
+* while the previous version stays in use.
+*/
+class ShaderReloader
+{
+	public:
+		ShaderReloader(std::string const& vsFile, std::string const& fsFile);
+		~ShaderReloader();
+
+		// Returns false if the shader files could not be read
+		bool sourcesLoaded() const;
+
+		/**
+		* Returns the newest linked program of the variant with the given defines. The first time
+		* a variant is requested it is compiled in the background, and 0 is returned until it has
+		* linked, or when it does not compile. Only the very first request waits for the compiler.
+		*
+		* Variants requested with the same non-empty family must have the same attributes and
+		* uniforms. Until the variant has linked, the newest program of the variant of its family
+		* which was returned last is used instead. The returned program stays valid until the next
+		* call to program() or update(), which may delete the programs they replace.
+		*/
+		GLuint program(std::vector<std::string> const& defines, std::string const& family = "");
+
+		/**
+		* Checks the compilations for completion, and the shader files for changes when checkFiles is set.
+		* Returns true if a program has been replaced, so the scene should be drawn again.
+		*/
+		bool update(bool checkFiles = true);
+
+		// True while a compilation is running, update() should then be called often
+		bool compiling() const;
+
+	private:
+		struct Variant {
+			std::vector<std::string> defines;
+			GLuint current;
+			GLuint pending;
+		};
+
+		bool readSources();
+		void startCompile(Variant& variant);
+		bool finishCompile(Variant& variant);
+
+	private:
+		std::string m_vsFile, m_fsFile;
+		std::string m_vs, m_fs;
+		time_t m_vsTime, m_fsTime;
+		bool m_loaded;
+
+		std::map<std::string, Variant> m_variants;
+		// The key of the linked variant which was returned last for each family
+		std::map<std::string, std::string> m_families;
+		// True once any variant has linked, until then program() waits
+		bool m_linked;
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include "Software_renderer.h"
+#include "Triangle_rasterizer.h"
+
+Software_renderer::Software_renderer(int width, int height)
+	: colors(width, height), depths(width, height), window_viewport(1.0f), batch_count(0)
+{
+	this->depths.depth_func(Depth_buffer::GREATER);
+	this->depths.clear_depth(-1.0f);
+	this->depths.clear();
+}
+
+Software_renderer::~Software_renderer(void)
+{
+}
+
+void Software_renderer::resize(int width, int height)
+{
+	this->colors.resize(width, height);
+	this->depths.resize(width, height);
+}
+
+void Software_renderer::clear(glm::vec4 const& color)
+{
+	this->colors.clear(Frame_buffer::pack(color.r, color.g, color.b, color.a));
+	this->depths.clear();
+}
+
+void Software_renderer::matrices(glm::mat4x4 const& model, glm::mat4x4 const& projection, glm::mat3x3 const& normal,
+								 glm::mat4x4 const& window_viewport)
+{
+	this->vertex_processor.matrices(model, projection, normal);
+	this->phong_shader.model_matrix(model);
+	this->window_viewport = window_viewport;
+}
+
+Phong_shader& Software_renderer::shader()
+{
+	return this->phong_shader;
+}
+
+Frame_buffer const& Software_renderer::frame_buffer() const
+{
+	return this->colors;
+}
+
+void Software_renderer::draw_triangles(Vertex_arrays const& vertices)
+{
+	this->vertex_processor.transform(vertices, this->transformed);
+	this->draw_transformed();
+}
+
+void Software_renderer::draw_indexed_triangles(Vertex_arrays const& vertices, std::vector<unsigned int> const& indices)
+{
+	this->vertex_processor.transform_indexed(vertices, indices, this->transformed);
+	this->draw_transformed();
+}
+
+void Software_renderer::draw_transformed()
+{
+	this->clip_vertices.clear();
+	this->transformed.to_clip_vertices(this->clip_vertices);
+
+	this->clipped.clear();
+	this->clipper.clip_triangles(this->clip_vertices, this->clipped);
+
+	this->window_vertices.clear();
+	Clipper::to_window(this->clipped, this->window_viewport, this->window_vertices);
+
+	for (size_t i = 0; i + 2 < this->window_vertices.size(); i += 3) {
+		this->draw_triangle(this->window_vertices[i], this->window_vertices[i + 1], this->window_vertices[i + 2]);
+	}
+	this->flush_fragments();
+}
+
+void Software_renderer::draw_triangle(Raster_vertex const& v1, Raster_vertex const& v2, Raster_vertex const& v3)
+{
+	// Counter-clockwise triangles in window coordinates are front facing, like glFrontFace(GL_CCW)
+	long long area = (long long)(v2.x - v1.x) * (v3.y - v1.y) - (long long)(v3.x - v1.x) * (v2.y - v1.y);
+	unsigned char front_facing = (area >= 0) ? 1 : 0;
+
+	Triangle_rasterizer rasterizer;
+	rasterizer.init(v1, v2, v3, &this->depths);
+	while (rasterizer.more_fragments()) {
+		int x = rasterizer.x();
+		int y = rasterizer.y();
+		if (this->depths.test_and_write(x, y, rasterizer.z())) {
+			int n = this->batch_count++;
+			this->batch_x[n] = x;
+			this->batch_y[n] = y;
+			this->batch_px[n] = rasterizer.attribute(0);
+			this->batch_py[n] = rasterizer.attribute(1);
+			this->batch_pz[n] = rasterizer.attribute(2);
+			this->batch_nx[n] = rasterizer.attribute(3);
+			this->batch_ny[n] = rasterizer.attribute(4);
+			this->batch_nz[n] = rasterizer.attribute(5);
+			this->batch_front_facing[n] = front_facing;
+			if (this->batch_count == BATCH_SIZE) {
+				this->flush_fragments();
+			}
+		}
+		rasterizer.next_fragment();
+	}
+}
+
+void Software_renderer::flush_fragments()
+{
+	if (this->batch_count == 0) {
+		return;
+	}
+
+	Fragment_batch batch;
+	batch.px = this->batch_px; batch.py = this->batch_py; batch.pz = this->batch_pz;
+	batch.nx = this->batch_nx; batch.ny = this->batch_ny; batch.nz = this->batch_nz;
+	batch.front_facing = this->batch_front_facing;
+	batch.r = this->batch_r; batch.g = this->batch_g; batch.b = this->batch_b;
+	batch.count = this->batch_count;
+	this->phong_shader.shade(batch);
+
+	// The fragments are written in the order they were rasterized, so a later
+	// fragment in the batch overwrites an earlier one at the same pixel
+	for (int i = 0; i < this->batch_count; i++) {
+		this->colors.set_pixel(this->batch_x[i], this->batch_y[i],
+							   Frame_buffer::pack(this->batch_r[i], this->batch_g[i], this->batch_b[i], 1.0f));
+	}
+	this->batch_count = 0;
+}
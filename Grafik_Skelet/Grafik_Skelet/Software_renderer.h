@@ -0,0 +1,76 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "glmutils.h"
+#include "Frame_buffer.h"
+#include "Depth_buffer.h"
+#include "Vertex_processor.h"
+#include "Clipper.h"
+#include "Phong_shader.h"
+
+/**
+* Renders triangle meshes into a Frame_buffer with the software pipeline,
+* so that the output is the same as drawScene() renders with Shader.vert and
+* Shader.frag, but without any window or OpenGL context.
+*
+* The vertices go through the Vertex_processor and the Clipper, the
+* fragments are depth tested as they are rasterized, and the fragments which
+* pass are shaded in batches by the Phong_shader.
+*/
+class Software_renderer
+{
+public:
+	Software_renderer(int width, int height);
+	virtual ~Software_renderer(void);
+
+	void resize(int width, int height);
+
+	// Clears the colors to color and the depths like glClearDepth(-1) with glDepthFunc(GL_GREATER)
+	void clear(glm::vec4 const& color);
+
+	// Same matrices as the uniforms of Shader.vert, and the WindowViewport matrix of the Camera
+	void matrices(glm::mat4x4 const& model, glm::mat4x4 const& projection, glm::mat3x3 const& normal,
+				  glm::mat4x4 const& window_viewport);
+
+	// The material and the light are set directly on the shader
+	Phong_shader& shader();
+
+	// Draws the triangles given as triples of vertices, like glDrawArrays(GL_TRIANGLES, ...)
+	void draw_triangles(Vertex_arrays const& vertices);
+	// Draws the triangles given as triples of indices, like glDrawElements(GL_TRIANGLES, ...).
+	// The shared vertices go through the post-transform cache of the Vertex_processor
+	void draw_indexed_triangles(Vertex_arrays const& vertices, std::vector<unsigned int> const& indices);
+
+	Frame_buffer const& frame_buffer() const;
+private:
+	// Clips, rasterizes and shades the triangles in transformed
+	void draw_transformed();
+	void draw_triangle(Raster_vertex const& v1, Raster_vertex const& v2, Raster_vertex const& v3);
+	void flush_fragments();
+
+	Frame_buffer colors;
+	Depth_buffer depths;
+
+	Vertex_processor vertex_processor;
+	Clipper clipper;
+	Phong_shader phong_shader;
+
+	glm::mat4x4 window_viewport;
+
+	// Temporary storage, kept between the draws to avoid reallocations
+	Transformed_vertices transformed;
+	std::vector<Clip_vertex> clip_vertices;
+	std::vector<Clip_vertex> clipped;
+	std::vector<Raster_vertex> window_vertices;
+
+	// Fragments which passed the depth test and wait to be shaded
+	static const int BATCH_SIZE = 256;
+	int batch_count;
+	int batch_x[BATCH_SIZE]; int batch_y[BATCH_SIZE];
+	float batch_px[BATCH_SIZE]; float batch_py[BATCH_SIZE]; float batch_pz[BATCH_SIZE];
+	float batch_nx[BATCH_SIZE]; float batch_ny[BATCH_SIZE]; float batch_nz[BATCH_SIZE];
+	unsigned char batch_front_facing[BATCH_SIZE];
+	float batch_r[BATCH_SIZE]; float batch_g[BATCH_SIZE]; float batch_b[BATCH_SIZE];
+};
+
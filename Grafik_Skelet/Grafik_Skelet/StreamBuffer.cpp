@@ -0,0 +1,132 @@
+/** @file
+* A ring of buffer regions for vertex data which is written again every frame.
+*/
+
+#include "StreamBuffer.h"
+
+StreamBuffer::StreamBuffer(GLenum target, GLsizeiptr regionSize, int numRegions)
+{
+	m_target = target;
+	m_buffer = 0;
+	m_mapped = NULL;
+	m_persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+	m_fences.resize(numRegions < 2 ? 2 : numRegions, 0);
+	m_region = 0;
+	m_used = 0;
+	m_waited = false;
+	allocate(regionSize < ALIGNMENT ? (GLsizeiptr)ALIGNMENT : regionSize);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	release();
+}
+
+void* StreamBuffer::map(GLsizeiptr size, GLintptr* offset)
+{
+	if(!m_waited)
+	{
+		// Wait in steps of 1 ms, the flush bit makes sure the fence is ever reached
+		GLsync& fence = m_fences[m_region];
+		if(fence != 0)
+		{
+			GLenum status = GL_TIMEOUT_EXPIRED;
+			while(status == GL_TIMEOUT_EXPIRED)
+				status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			glDeleteSync(fence);
+			fence = 0;
+		}
+		m_waited = true;
+	}
+
+	GLsizeiptr start = (m_used + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	if(start + size > m_regionSize)
+	{
+		// The draws issued from the old buffer keep it alive until they are done
+		GLsizeiptr regionSize = m_regionSize * 2;
+		while(regionSize < size)
+			regionSize *= 2;
+		release();
+		allocate(regionSize);
+		m_waited = true;
+		start = 0;
+	}
+	m_used = start + size;
+	*offset = m_region * m_regionSize + start;
+
+	if(m_persistent)
+		return m_mapped + *offset;
+
+	glBindBuffer(m_target, m_buffer);
+	return glMapBufferRange(m_target, *offset, size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+}
+
+void StreamBuffer::unmap()
+{
+	if(m_persistent)
+		return;
+
+	glUnmapBuffer(m_target);
+	glBindBuffer(m_target, 0);
+}
+
+void StreamBuffer::advance()
+{
+	if(!m_waited)
+		return;
+
+	m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_region = (m_region + 1) % m_fences.size();
+	m_used = 0;
+	m_waited = false;
+}
+
+GLuint StreamBuffer::buffer() const
+{
+	return m_buffer;
+}
+
+bool StreamBuffer::persistent() const
+{
+	return m_persistent;
+}
+
+void StreamBuffer::allocate(GLsizeiptr regionSize)
+{
+	m_regionSize = regionSize;
+	GLsizeiptr size = m_regionSize * m_fences.size();
+
+	glGenBuffers(1, &m_buffer);
+	glBindBuffer(m_target, m_buffer);
+	if(m_persistent)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(m_target, size, NULL, flags);
+		m_mapped = (unsigned char*)glMapBufferRange(m_target, 0, size, flags);
+	}
+	else
+	{
+		glBufferData(m_target, size, NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(m_target, 0);
+}
+
+void StreamBuffer::release()
+{
+	for(size_t i = 0; i < m_fences.size(); i++)
+	{
+		if(m_fences[i] != 0)
+			glDeleteSync(m_fences[i]);
+		m_fences[i] = 0;
+	}
+
+	if(m_mapped != NULL)
+	{
+		glBindBuffer(m_target, m_buffer);
+		glUnmapBuffer(m_target);
+		glBindBuffer(m_target, 0);
+		m_mapped = NULL;
+	}
+	glDeleteBuffers(1, &m_buffer);
+	m_buffer = 0;
+}
@@ -0,0 +1,78 @@
+/** @file
+* A ring of buffer regions for vertex data which is written again every frame.
+*/
+
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#if defined(WIN32) || defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#endif
+
+#if defined(__APPLE__) && defined(__MACH__)
+	#include <OpenGL/glew.h>
+	#include <OpenGL/gl.h>
+	#include <OpenGL/glu.h>
+#else
+	#include <GL/glew.h>
+	#include <GL/gl.h>
+	#include <GL/glu.h>
+#endif
+
+#include <vector>
+
+/**
+* The buffer is split into regions which are used in turn, and a fence is put
+* after the draws which read a region, so it is only written again when the
+* GPU is done with it. Writing never waits for the draws of the last frames,
+* and the buffer is never specified again, unlike glBufferData every frame.
+*
+* With GL 4.4 or ARB_buffer_storage the buffer is created with glBufferStorage
+* and stays mapped persistently and coherently. Otherwise every map() is a
+* glMapBufferRange with GL_MAP_UNSYNCHRONIZED_BIT, which the fences make safe.
+*
+* A region grows when an allocation does not fit, which replaces buffer(),
+* so it must be bound after map() and each region should be mapped once.
+*/
+class StreamBuffer
+{
+	public:
+		/** target is only used to map the buffer, the buffer can be bound to any target */
+		StreamBuffer(GLenum target, GLsizeiptr regionSize, int numRegions = 3);
+		~StreamBuffer();
+
+		/**
+		* Allocates size bytes in the current region, waiting for its fence the first time.
+		* @param offset the offset of the allocation in buffer(), a multiple of ALIGNMENT
+		* @return where the data is written, until unmap()
+		*/
+		void* map(GLsizeiptr size, GLintptr* offset);
+		void unmap();
+
+		/** Fences the current region after the draws which read it, and moves on to the next one */
+		void advance();
+
+		GLuint buffer() const;
+		bool persistent() const;
+
+		// Enough for vertex attributes, draw commands and uniform buffer offsets
+		static const GLsizeiptr ALIGNMENT = 256;
+
+	private:
+		void allocate(GLsizeiptr regionSize);
+		void release();
+
+		GLenum m_target;
+		GLuint m_buffer;
+		GLsizeiptr m_regionSize;
+		unsigned char* m_mapped;
+		bool m_persistent;
+
+		std::vector<GLsync> m_fences;
+		int m_region;
+		GLsizeiptr m_used;
+		bool m_waited;
+};
+
+#endif
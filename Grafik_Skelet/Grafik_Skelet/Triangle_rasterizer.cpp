@@ -0,0 +1,209 @@
+#include "Triangle_rasterizer.h"
+#include <algorithm>
+#include <stdexcept>
+
+// Used for sorting the vertices by their y-coordinate
+static bool lower_y(Raster_vertex const& v1, Raster_vertex const& v2)
+{
+	return v1.y < v2.y;
+}
+
+// Floor division by the tile size, also for negative coordinates
+static int tile_of(int x)
+{
+	return (x >= 0) ? x / Depth_buffer::TILE_SIZE : -((Depth_buffer::TILE_SIZE - 1 - x) / Depth_buffer::TILE_SIZE);
+}
+
+void Triangle_rasterizer::init(Raster_vertex const& v1, Raster_vertex const& v2, Raster_vertex const& v3)
+{
+	this->init(v1, v2, v3, 0);
+}
+
+void Triangle_rasterizer::init(Raster_vertex const& v1, Raster_vertex const& v2, Raster_vertex const& v3,
+							   Depth_buffer* occlusion_buffer)
+{
+	this->occlusion_buffer = occlusion_buffer;
+	if (occlusion_buffer != 0) {
+		this->z_min = std::min(std::min(v1.z, v2.z), v3.z);
+		this->z_max = std::max(std::max(v1.z, v2.z), v3.z);
+
+		// Reject the whole triangle if it is hidden everywhere in its bounding box
+		if (occlusion_buffer->occluded(
+				std::min(std::min(v1.x, v2.x), v3.x), std::min(std::min(v1.y, v2.y), v3.y),
+				std::max(std::max(v1.x, v2.x), v3.x), std::max(std::max(v1.y, v2.y), v3.y),
+				this->z_min, this->z_max)) {
+			this->valid = false;
+			return;
+		}
+	}
+
+	Raster_vertex ys[3] = {v1, v2, v3};
+	std::sort(ys, ys + 3, lower_y);
+
+	// The attribute arrays have a fixed size, whatever the vertices claim
+	this->n_attributes = std::min(std::min(std::min(v1.num_attributes, v2.num_attributes), v3.num_attributes),
+								  MAX_RASTER_ATTRIBUTES);
+
+	// Same choice of edges as drawTriangle() in Main.cpp
+	if (ys[1].y == ys[0].y) {
+		// The peak is at the top
+		this->left_edge.init(ys[0], ys[2]);
+		this->right_edge.init(ys[1], ys[2]);
+	}
+	else if (ys[1].y == ys[2].y) {
+		// The peak is at the bottom
+		this->left_edge.init(ys[0], ys[1]);
+		this->right_edge.init(ys[0], ys[2]);
+	}
+	else {
+		this->left_edge.init(ys[0], ys[2]);
+		this->right_edge.init(ys[0], ys[1], ys[2]);
+	}
+
+	this->init_span();
+}
+
+void Triangle_rasterizer::init_span()
+{
+	while (this->left_edge.more_fragments() && this->right_edge.more_fragments()) {
+		Edge_rasterizer* left = &this->left_edge;
+		Edge_rasterizer* right = &this->right_edge;
+		if (left->x_unchecked() > right->x_unchecked()) {
+			std::swap(left, right);
+		}
+
+		this->x_current = left->x_unchecked();
+		this->x_stop = right->x_unchecked();
+		this->y_current = left->y_unchecked();
+
+		if (this->x_current < this->x_stop) {
+			float inv_dx = 1.0f / float(this->x_stop - this->x_current);
+
+			this->z_current = left->z();
+			this->z_step = (right->z() - left->z()) * inv_dx;
+
+			this->inv_w_current = left->inv_w();
+			this->inv_w_step = (right->inv_w() - left->inv_w()) * inv_dx;
+
+			for (int i = 0; i < this->n_attributes; i++) {
+				this->attr_current[i] = left->attribute_over_w(i);
+				this->attr_step[i] = (right->attribute_over_w(i) - left->attribute_over_w(i)) * inv_dx;
+			}
+
+			this->skip_occluded_tiles();
+			if (this->x_current < this->x_stop) {
+				this->valid = true;
+				return;
+			}
+		}
+
+		// Empty span, go to the next scanline
+		this->left_edge.next_fragment();
+		this->right_edge.next_fragment();
+	}
+	this->valid = false;
+}
+
+bool Triangle_rasterizer::more_fragments() const
+{
+	return this->valid;
+}
+
+void Triangle_rasterizer::advance(int steps)
+{
+	this->x_current += steps;
+	this->z_current += this->z_step * steps;
+	this->inv_w_current += this->inv_w_step * steps;
+	for (int i = 0; i < this->n_attributes; i++) {
+		this->attr_current[i] += this->attr_step[i] * steps;
+	}
+}
+
+void Triangle_rasterizer::skip_occluded_tiles()
+{
+	if (this->occlusion_buffer == 0) {
+		return;
+	}
+	int tile_y = tile_of(this->y_current);
+	while (this->x_current < this->x_stop) {
+		int tile_x = tile_of(this->x_current);
+		if (!this->occlusion_buffer->tile_occluded(tile_x, tile_y, this->z_min, this->z_max)) {
+			return;
+		}
+		int next_tile = (tile_x + 1) * Depth_buffer::TILE_SIZE;
+		this->advance(std::min(next_tile, this->x_stop) - this->x_current);
+	}
+}
+
+void Triangle_rasterizer::next_fragment()
+{
+	this->x_current++;
+	if (this->x_current < this->x_stop) {
+		this->z_current += this->z_step;
+		this->inv_w_current += this->inv_w_step;
+		for (int i = 0; i < this->n_attributes; i++) {
+			this->attr_current[i] += this->attr_step[i];
+		}
+		// Entering a new tile
+		if (this->occlusion_buffer != 0 && (this->x_current % Depth_buffer::TILE_SIZE) == 0) {
+			this->skip_occluded_tiles();
+			if (this->x_current >= this->x_stop) {
+				this->left_edge.next_fragment();
+				this->right_edge.next_fragment();
+				this->init_span();
+			}
+		}
+	}
+	else {
+		this->left_edge.next_fragment();
+		this->right_edge.next_fragment();
+		this->init_span();
+	}
+}
+
+int Triangle_rasterizer::x() const
+{
+	if (!this->valid) {
+		throw std::runtime_error("triangle_rasterizer::x(): Invalid State");
+	}
+	return this->x_current;
+}
+
+int Triangle_rasterizer::y() const
+{
+	if (!this->valid) {
+		throw std::runtime_error("triangle_rasterizer::y(): Invalid State");
+	}
+	return this->y_current;
+}
+
+float Triangle_rasterizer::z() const
+{
+	if (!this->valid) {
+		throw std::runtime_error("triangle_rasterizer::z(): Invalid State");
+	}
+	return this->z_current;
+}
+
+int Triangle_rasterizer::num_attributes() const
+{
+	return this->n_attributes;
+}
+
+float Triangle_rasterizer::attribute(int i) const
+{
+	if (!this->valid || i < 0 || i >= this->n_attributes) {
+		throw std::runtime_error("triangle_rasterizer::attribute(): Invalid State");
+	}
+	// Perspective correct value of the attribute
+	return this->attr_current[i] / this->inv_w_current;
+}
+
+Triangle_rasterizer::Triangle_rasterizer() : n_attributes(0), occlusion_buffer(0), valid(false)
+{
+}
+
+
+Triangle_rasterizer::~Triangle_rasterizer()
+{
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "Raster_vertex.h"
+#include "Edge_rasterizer.h"
+#include "Depth_buffer.h"
+
+/**
+* Rasterizes a filled triangle one fragment at a time. The depth of the
+* fragments is interpolated linearly, and the attributes of the vertices
+* are interpolated perspective correct.
+*
+* If a depth buffer is given to init(), its tile bounds are used to reject
+* the whole triangle, or the parts of the spans which fall in tiles where
+* no fragment of the triangle can pass the depth test.
+*/
+class Triangle_rasterizer
+{
+public:
+	Triangle_rasterizer(void);
+	virtual ~Triangle_rasterizer(void);
+
+	void init(Raster_vertex const& v1, Raster_vertex const& v2, Raster_vertex const& v3);
+	void init(Raster_vertex const& v1, Raster_vertex const& v2, Raster_vertex const& v3,
+			  Depth_buffer* occlusion_buffer);
+	bool more_fragments() const;
+	void next_fragment();
+
+	int x() const;
+	int y() const;
+	float z() const;
+
+	int num_attributes() const;
+	float attribute(int i) const;
+private:
+	// Sets up the span between the edges, skipping scanlines without fragments
+	void init_span();
+	// Advances past the tiles of the current span in which the triangle is hidden
+	void skip_occluded_tiles();
+	void advance(int steps);
+
+	Edge_rasterizer left_edge;
+	Edge_rasterizer right_edge;
+
+	int x_current;
+	int x_stop;
+	int y_current;
+
+	int n_attributes;
+	float z_current; float z_step;
+	float inv_w_current; float inv_w_step;
+	float attr_current[MAX_RASTER_ATTRIBUTES];
+	float attr_step[MAX_RASTER_ATTRIBUTES];
+
+	Depth_buffer* occlusion_buffer;
+	float z_min; float z_max;
+
+	bool valid;
+};
+
@@ -0,0 +1,54 @@
+/** @file
+* A uniform buffer object bound to a fixed uniform block binding point.
+*/
+
+#include "UniformBuffer.h"
+
+#include <cstring>
+
+UniformBuffer::UniformBuffer(GLuint binding, GLsizeiptr size)
+{
+	m_binding = binding;
+	m_contents.resize(size);
+	m_uploaded = false;
+
+	glGenBuffers(1, &m_buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+	glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	glBindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_buffer);
+}
+
+UniformBuffer::~UniformBuffer()
+{
+	glDeleteBuffers(1, &m_buffer);
+}
+
+void UniformBuffer::update(void const* data)
+{
+	if(m_uploaded && memcmp(&m_contents[0], data, m_contents.size()) == 0)
+		return;
+
+	memcpy(&m_contents[0], data, m_contents.size());
+	m_uploaded = true;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, m_contents.size(), &m_contents[0]);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffer::bind() const
+{
+	glBindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_buffer);
+}
+
+GLuint UniformBuffer::binding() const
+{
+	return m_binding;
+}
+
+GLuint UniformBuffer::buffer() const
+{
+	return m_buffer;
+}
@@ -0,0 +1,50 @@
+/** @file
+* A uniform buffer object bound to a fixed uniform block binding point.
+*/
+
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#if defined(WIN32) || defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#endif
+
+#if defined(__APPLE__) && defined(__MACH__)
+	#include <OpenGL/glew.h>
+	#include <OpenGL/gl.h>
+	#include <OpenGL/glu.h>
+#else
+	#include <GL/glew.h>
+	#include <GL/gl.h>
+	#include <GL/glu.h>
+#endif
+
+#include <vector>
+
+class UniformBuffer
+{
+	public:
+		UniformBuffer(GLuint binding, GLsizeiptr size);
+		~UniformBuffer();
+
+		/**
+		* Uploads size bytes from data, but only if they differ from the last upload,
+		* so parameters which stay the same are only sent to the driver once.
+		*/
+		void update(void const* data);
+
+		/** Binds the buffer to its binding point again, when several buffers share the same one */
+		void bind() const;
+
+		GLuint binding() const;
+		GLuint buffer() const;
+
+	private:
+		GLuint m_buffer;
+		GLuint m_binding;
+		std::vector<unsigned char> m_contents;
+		bool m_uploaded;
+};
+
+#endif
@@ -0,0 +1,245 @@
+#include "Vertex_processor.h"
+#include <cmath>
+
+#if defined(VERTEX_PROCESSOR_AVX2)
+	#include <immintrin.h>
+#elif defined(VERTEX_PROCESSOR_SSE2)
+	#include <emmintrin.h>
+#endif
+
+void Vertex_arrays::resize(size_t size)
+{
+	this->x.resize(size); this->y.resize(size); this->z.resize(size);
+	this->nx.resize(size); this->ny.resize(size); this->nz.resize(size);
+}
+
+size_t Vertex_arrays::size() const
+{
+	return this->x.size();
+}
+
+void Vertex_arrays::set(size_t i, glm::vec3 const& position, glm::vec3 const& normal)
+{
+	this->x[i] = position.x; this->y[i] = position.y; this->z[i] = position.z;
+	this->nx[i] = normal.x; this->ny[i] = normal.y; this->nz[i] = normal.z;
+}
+
+void Transformed_vertices::resize(size_t size)
+{
+	this->clip_x.resize(size); this->clip_y.resize(size); this->clip_z.resize(size); this->clip_w.resize(size);
+	this->eye_x.resize(size); this->eye_y.resize(size); this->eye_z.resize(size);
+	this->nx.resize(size); this->ny.resize(size); this->nz.resize(size);
+}
+
+size_t Transformed_vertices::size() const
+{
+	return this->clip_x.size();
+}
+
+void Transformed_vertices::to_clip_vertices(std::vector<Clip_vertex>& out) const
+{
+	out.reserve(out.size() + this->size());
+	for (size_t i = 0; i < this->size(); i++) {
+		Clip_vertex v;
+		v.position = glm::vec4(this->clip_x[i], this->clip_y[i], this->clip_z[i], this->clip_w[i]);
+		v.num_attributes = 6;
+		v.attributes[0] = this->eye_x[i]; v.attributes[1] = this->eye_y[i]; v.attributes[2] = this->eye_z[i];
+		v.attributes[3] = this->nx[i]; v.attributes[4] = this->ny[i]; v.attributes[5] = this->nz[i];
+		out.push_back(v);
+	}
+}
+
+Vertex_processor::Vertex_processor(void) : model(1.0f), model_projection(1.0f), normal(1.0f)
+{
+	this->cache.resize(CACHE_SIZE);
+	this->reset_cache();
+}
+
+Vertex_processor::~Vertex_processor(void)
+{
+}
+
+void Vertex_processor::matrices(glm::mat4x4 const& model, glm::mat4x4 const& projection, glm::mat3x3 const& normal)
+{
+	this->model = model;
+	this->model_projection = projection * model;
+	this->normal = normal;
+	// The cached vertices were transformed with the old matrices
+	this->reset_cache();
+}
+
+void Vertex_processor::transform_scalar(Vertex_arrays const& in, size_t in_index,
+										Transformed_vertices& out, size_t out_index) const
+{
+	glm::vec4 position(in.x[in_index], in.y[in_index], in.z[in_index], 1.0f);
+	glm::vec4 clip = this->model_projection * position;
+	glm::vec4 eye = this->model * position;
+	glm::vec3 n = glm::normalize(this->normal * glm::vec3(in.nx[in_index], in.ny[in_index], in.nz[in_index]));
+
+	out.clip_x[out_index] = clip.x; out.clip_y[out_index] = clip.y; out.clip_z[out_index] = clip.z; out.clip_w[out_index] = clip.w;
+	out.eye_x[out_index] = eye.x; out.eye_y[out_index] = eye.y; out.eye_z[out_index] = eye.z;
+	out.nx[out_index] = n.x; out.ny[out_index] = n.y; out.nz[out_index] = n.z;
+}
+
+void Vertex_processor::transform(Vertex_arrays const& in, Transformed_vertices& out) const
+{
+	size_t count = in.size();
+	out.resize(count);
+
+	size_t i = 0;
+#if defined(VERTEX_PROCESSOR_AVX2)
+	i = count - count % 8;
+	this->transform_avx2(in, out, i);
+#elif defined(VERTEX_PROCESSOR_SSE2)
+	i = count - count % 4;
+	this->transform_sse2(in, out, i);
+#endif
+	for (; i < count; i++) {
+		this->transform_scalar(in, i, out, i);
+	}
+}
+
+#if defined(VERTEX_PROCESSOR_AVX2)
+
+// Row r of the matrix m times the vector (x, y, z, w), where m is column major like glm
+static inline __m256 row4_ps(glm::mat4x4 const& m, int r, __m256 x, __m256 y, __m256 z)
+{
+	__m256 result = _mm256_set1_ps(m[3][r]);
+	result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_set1_ps(m[0][r]), x));
+	result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_set1_ps(m[1][r]), y));
+	return _mm256_add_ps(result, _mm256_mul_ps(_mm256_set1_ps(m[2][r]), z));
+}
+
+static inline __m256 row3_ps(glm::mat3x3 const& m, int r, __m256 x, __m256 y, __m256 z)
+{
+	__m256 result = _mm256_mul_ps(_mm256_set1_ps(m[0][r]), x);
+	result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_set1_ps(m[1][r]), y));
+	return _mm256_add_ps(result, _mm256_mul_ps(_mm256_set1_ps(m[2][r]), z));
+}
+
+void Vertex_processor::transform_avx2(Vertex_arrays const& in, Transformed_vertices& out, size_t count) const
+{
+	for (size_t i = 0; i < count; i += 8) {
+		__m256 x = _mm256_loadu_ps(&in.x[i]);
+		__m256 y = _mm256_loadu_ps(&in.y[i]);
+		__m256 z = _mm256_loadu_ps(&in.z[i]);
+
+		_mm256_storeu_ps(&out.clip_x[i], row4_ps(this->model_projection, 0, x, y, z));
+		_mm256_storeu_ps(&out.clip_y[i], row4_ps(this->model_projection, 1, x, y, z));
+		_mm256_storeu_ps(&out.clip_z[i], row4_ps(this->model_projection, 2, x, y, z));
+		_mm256_storeu_ps(&out.clip_w[i], row4_ps(this->model_projection, 3, x, y, z));
+
+		_mm256_storeu_ps(&out.eye_x[i], row4_ps(this->model, 0, x, y, z));
+		_mm256_storeu_ps(&out.eye_y[i], row4_ps(this->model, 1, x, y, z));
+		_mm256_storeu_ps(&out.eye_z[i], row4_ps(this->model, 2, x, y, z));
+
+		__m256 nx = _mm256_loadu_ps(&in.nx[i]);
+		__m256 ny = _mm256_loadu_ps(&in.ny[i]);
+		__m256 nz = _mm256_loadu_ps(&in.nz[i]);
+		__m256 tx = row3_ps(this->normal, 0, nx, ny, nz);
+		__m256 ty = row3_ps(this->normal, 1, nx, ny, nz);
+		__m256 tz = row3_ps(this->normal, 2, nx, ny, nz);
+
+		// Exact normalization, the normals are interpolated and normalized again later
+		__m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tx, tx), _mm256_mul_ps(ty, ty)),
+													 _mm256_mul_ps(tz, tz)));
+		_mm256_storeu_ps(&out.nx[i], _mm256_div_ps(tx, length));
+		_mm256_storeu_ps(&out.ny[i], _mm256_div_ps(ty, length));
+		_mm256_storeu_ps(&out.nz[i], _mm256_div_ps(tz, length));
+	}
+}
+
+#elif defined(VERTEX_PROCESSOR_SSE2)
+
+// Row r of the matrix m times the vector (x, y, z, w), where m is column major like glm
+static inline __m128 row4_ps(glm::mat4x4 const& m, int r, __m128 x, __m128 y, __m128 z)
+{
+	__m128 result = _mm_set1_ps(m[3][r]);
+	result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(m[0][r]), x));
+	result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(m[1][r]), y));
+	return _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(m[2][r]), z));
+}
+
+static inline __m128 row3_ps(glm::mat3x3 const& m, int r, __m128 x, __m128 y, __m128 z)
+{
+	__m128 result = _mm_mul_ps(_mm_set1_ps(m[0][r]), x);
+	result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(m[1][r]), y));
+	return _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(m[2][r]), z));
+}
+
+void Vertex_processor::transform_sse2(Vertex_arrays const& in, Transformed_vertices& out, size_t count) const
+{
+	for (size_t i = 0; i < count; i += 4) {
+		__m128 x = _mm_loadu_ps(&in.x[i]);
+		__m128 y = _mm_loadu_ps(&in.y[i]);
+		__m128 z = _mm_loadu_ps(&in.z[i]);
+
+		_mm_storeu_ps(&out.clip_x[i], row4_ps(this->model_projection, 0, x, y, z));
+		_mm_storeu_ps(&out.clip_y[i], row4_ps(this->model_projection, 1, x, y, z));
+		_mm_storeu_ps(&out.clip_z[i], row4_ps(this->model_projection, 2, x, y, z));
+		_mm_storeu_ps(&out.clip_w[i], row4_ps(this->model_projection, 3, x, y, z));
+
+		_mm_storeu_ps(&out.eye_x[i], row4_ps(this->model, 0, x, y, z));
+		_mm_storeu_ps(&out.eye_y[i], row4_ps(this->model, 1, x, y, z));
+		_mm_storeu_ps(&out.eye_z[i], row4_ps(this->model, 2, x, y, z));
+
+		__m128 nx = _mm_loadu_ps(&in.nx[i]);
+		__m128 ny = _mm_loadu_ps(&in.ny[i]);
+		__m128 nz = _mm_loadu_ps(&in.nz[i]);
+		__m128 tx = row3_ps(this->normal, 0, nx, ny, nz);
+		__m128 ty = row3_ps(this->normal, 1, nx, ny, nz);
+		__m128 tz = row3_ps(this->normal, 2, nx, ny, nz);
+
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, tx), _mm_mul_ps(ty, ty)), _mm_mul_ps(tz, tz)));
+		_mm_storeu_ps(&out.nx[i], _mm_div_ps(tx, length));
+		_mm_storeu_ps(&out.ny[i], _mm_div_ps(ty, length));
+		_mm_storeu_ps(&out.nz[i], _mm_div_ps(tz, length));
+	}
+}
+
+#endif
+
+void Vertex_processor::transform_indexed(Vertex_arrays const& in, std::vector<unsigned int> const& indices,
+										 Transformed_vertices& out)
+{
+	// The entries of the last call may be vertices of another array with the same indices
+	this->invalidate_cache();
+
+	out.resize(indices.size());
+	for (size_t i = 0; i < indices.size(); i++) {
+		unsigned int index = indices[i];
+		int slot = index % CACHE_SIZE;
+
+		if (!this->cache_valid[slot] || this->cache_tags[slot] != index) {
+			this->transform_scalar(in, index, this->cache, slot);
+			this->cache_tags[slot] = index;
+			this->cache_valid[slot] = true;
+			this->misses++;
+		}
+		else {
+			this->hits++;
+		}
+
+		out.clip_x[i] = this->cache.clip_x[slot]; out.clip_y[i] = this->cache.clip_y[slot];
+		out.clip_z[i] = this->cache.clip_z[slot]; out.clip_w[i] = this->cache.clip_w[slot];
+		out.eye_x[i] = this->cache.eye_x[slot]; out.eye_y[i] = this->cache.eye_y[slot]; out.eye_z[i] = this->cache.eye_z[slot];
+		out.nx[i] = this->cache.nx[slot]; out.ny[i] = this->cache.ny[slot]; out.nz[i] = this->cache.nz[slot];
+	}
+}
+
+long Vertex_processor::cache_hits() const { return this->hits; }
+long Vertex_processor::cache_misses() const { return this->misses; }
+
+void Vertex_processor::reset_cache()
+{
+	this->invalidate_cache();
+	this->hits = 0;
+	this->misses = 0;
+}
+
+void Vertex_processor::invalidate_cache()
+{
+	for (int i = 0; i < CACHE_SIZE; i++) {
+		this->cache_valid[i] = false;
+	}
+}
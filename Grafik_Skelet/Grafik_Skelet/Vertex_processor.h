@@ -0,0 +1,94 @@
+#pragma once
+#include <vector>
+
+#include "glmutils.h"
+#include "Clipper.h"
+
+#if defined(__AVX2__)
+	#define VERTEX_PROCESSOR_AVX2
+#elif defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+	#define VERTEX_PROCESSOR_SSE2
+#endif
+
+/**
+* Vertex positions and normals (vertPosition and vertReflect of Shader.vert)
+* in structure-of-arrays layout.
+*/
+struct Vertex_arrays
+{
+	std::vector<float> x; std::vector<float> y; std::vector<float> z;
+	std::vector<float> nx; std::vector<float> ny; std::vector<float> nz;
+
+	void resize(size_t size);
+	size_t size() const;
+	void set(size_t i, glm::vec3 const& position, glm::vec3 const& normal);
+};
+
+/**
+* The outputs of Shader.vert: the clip coordinates (gl_Position), the eye
+* coordinates (curVert) and the normalized eye space normals (curNormalVec).
+*/
+struct Transformed_vertices
+{
+	std::vector<float> clip_x; std::vector<float> clip_y; std::vector<float> clip_z; std::vector<float> clip_w;
+	std::vector<float> eye_x; std::vector<float> eye_y; std::vector<float> eye_z;
+	std::vector<float> nx; std::vector<float> ny; std::vector<float> nz;
+
+	void resize(size_t size);
+	size_t size() const;
+
+	// Appends the vertices as Clip_vertex with the eye position and the normal as attributes 0-5
+	void to_clip_vertices(std::vector<Clip_vertex>& out) const;
+};
+
+/**
+* The vertex stage of the software pipeline, equivalent to Shader.vert.
+* The projection and model matrices are combined once, and whole arrays are
+* transformed 8 vertices at a time when compiled with AVX2, otherwise 4 at a
+* time with SSE2.
+*
+* Indexed meshes are transformed through a direct-mapped post-transform
+* cache, so vertices shared by neighbouring triangles are only transformed
+* once. The cache only lives for one call, since its entries are tagged by
+* the index alone.
+*/
+class Vertex_processor
+{
+public:
+	Vertex_processor(void);
+	virtual ~Vertex_processor(void);
+
+	// Same matrices as the uniforms uModelMatrix, projectionMatrix and normalvectorMatrix
+	void matrices(glm::mat4x4 const& model, glm::mat4x4 const& projection, glm::mat3x3 const& normal);
+
+	void transform(Vertex_arrays const& in, Transformed_vertices& out) const;
+
+	// Transforms in[indices[i]] into out[i]
+	void transform_indexed(Vertex_arrays const& in, std::vector<unsigned int> const& indices,
+						   Transformed_vertices& out);
+
+	// Number of cache hits and misses since the last call to reset_cache()
+	long cache_hits() const;
+	long cache_misses() const;
+	void reset_cache();
+private:
+	void invalidate_cache();
+	void transform_scalar(Vertex_arrays const& in, size_t in_index, Transformed_vertices& out, size_t out_index) const;
+#if defined(VERTEX_PROCESSOR_AVX2)
+	void transform_avx2(Vertex_arrays const& in, Transformed_vertices& out, size_t count) const;
+#elif defined(VERTEX_PROCESSOR_SSE2)
+	void transform_sse2(Vertex_arrays const& in, Transformed_vertices& out, size_t count) const;
+#endif
+
+	glm::mat4x4 model;
+	glm::mat4x4 model_projection;
+	glm::mat3x3 normal;
+
+	static const int CACHE_SIZE = 32;
+	unsigned int cache_tags[CACHE_SIZE];
+	bool cache_valid[CACHE_SIZE];
+	Transformed_vertices cache;
+	long hits;
+	long misses;
+};
+
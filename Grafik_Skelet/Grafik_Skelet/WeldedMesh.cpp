@@ -0,0 +1,44 @@
+/** @file
+* Welds a triangle list into unique vertices and indices, shared by the indexed meshes.
+*/
+
+#include "WeldedMesh.h"
+
+#include <map>
+
+bool WeldedVertex::operator<(WeldedVertex const& other) const
+{
+	for(int i = 0; i < 3; i++)
+	{
+		if(position[i] != other.position[i])
+			return position[i] < other.position[i];
+	}
+	for(int i = 0; i < 3; i++)
+	{
+		if(normal[i] != other.normal[i])
+			return normal[i] < other.normal[i];
+	}
+	return false;
+}
+
+void weldTriangles(std::vector<glm::vec3> const& vertices, std::vector<glm::vec3> const& normals,
+				   std::vector<WeldedVertex>* unique, std::vector<unsigned int>* indices)
+{
+	std::map<WeldedVertex, unsigned int> welded;
+	unique->clear();
+	indices->clear();
+	indices->reserve(vertices.size());
+	for(size_t i = 0; i < vertices.size(); i++)
+	{
+		WeldedVertex vertex;
+		vertex.position = vertices[i];
+		vertex.normal = normals[i];
+		std::map<WeldedVertex, unsigned int>::iterator found = welded.find(vertex);
+		if(found == welded.end())
+		{
+			found = welded.insert(std::make_pair(vertex, (unsigned int)unique->size())).first;
+			unique->push_back(vertex);
+		}
+		indices->push_back(found->second);
+	}
+}
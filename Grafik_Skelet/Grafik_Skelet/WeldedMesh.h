@@ -0,0 +1,30 @@
+/** @file
+* Welds a triangle list into unique vertices and indices, shared by the indexed meshes.
+*/
+
+#ifndef WELDED_MESH_H
+#define WELDED_MESH_H
+
+#include <vector>
+
+#include "glmutils.h"
+
+/** A vertex of a welded mesh, interleaved as it is uploaded */
+struct WeldedVertex
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+
+	// Ordered so it can be used as a map key
+	bool operator<(WeldedVertex const& other) const;
+};
+
+/**
+* Corners shared by neighbouring triangles with the same normal are stored once.
+* The triangles are given as triples of vertices, with a normal per vertex;
+* triangle i is made of unique[indices[3 * i]] to unique[indices[3 * i + 2]].
+*/
+void weldTriangles(std::vector<glm::vec3> const& vertices, std::vector<glm::vec3> const& normals,
+				   std::vector<WeldedVertex>* unique, std::vector<unsigned int>* indices);
+
+#endif